@@ -0,0 +1,35 @@
+#include <cmath>
+
+//Refer to this header file for documentation
+#include <Camera.h>
+#include <custom_math.h>
+
+Camera::Camera(){
+	wid = hig = 0;
+	spread = 0.0;
+	screenDist = 0.0;
+}
+
+bool Camera::update( int wid_, int hig_, double spread_ ){
+	
+	if( wid_ == wid && hig_ == hig && spread_ == spread )
+		return false;
+	
+	wid = wid_; hig = hig_;
+	spread = spread_;
+	
+	screenDist = (double)wid/( 2*std::tan(spread) );
+	
+	colAng.resize( wid );
+	colBam.resize( wid );
+	colCos.resize( wid );
+	
+	for( int i = 0; i < wid; i++ ){
+		//angle is calculated by atan, one column of pixels at a time, so that walls don't distort horizontally
+		colAng[i] = modPI( real_atan( screenDist, (double) ( ( wid >> 1 ) - i ) ) );
+		colBam[i] = (Sint32)rad_to_bam( colAng[i] );
+		colCos[i] = std::cos( colAng[i] );
+	}
+	
+	return true;
+}
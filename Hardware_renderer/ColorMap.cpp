@@ -0,0 +1,106 @@
+#include <map>
+#include <algorithm>
+
+//Refer to this header file for documentation
+#include <ColorMap.h>
+
+//palette entries the textures may take up, the rest are left to the plain colored walls
+const int TEXTURE_COLORS = 224;
+
+ColorMap::ColorMap(){
+	lightLevels = 0;
+}
+
+int ColorMap::nearest( Uint32 color ){
+	
+	int best = 0;
+	int bestDist = 0x7FFFFFFF;
+	
+	for( int i = 0; i < (int)palette.size(); i++ ){
+		int dr = (int)( ( color >> 16 ) & 0xFF ) - (int)( ( palette[i] >> 16 ) & 0xFF );
+		int dg = (int)( ( color >> 8 ) & 0xFF ) - (int)( ( palette[i] >> 8 ) & 0xFF );
+		int db = (int)( color & 0xFF ) - (int)( palette[i] & 0xFF );
+		int dist = dr*dr + dg*dg + db*db;
+		if( dist < bestDist ){
+			bestDist = dist;
+			best = i;
+		}
+	}
+	
+	return best;
+}
+
+void ColorMap::index_mips( const MipChain *mips, IndexedMips *indexed ){
+	
+	//how often every color shows up, over all the levels
+	std::map<Uint32, int> counts;
+	for( int l = 0; l < MIP_LEVELS; l++ )
+		for( Uint32 texel : mips->levels[l].pixels )
+			counts[texel | 0xFF000000u]++;
+	
+	//the most used colors go into the palette, the rest are matched to their closest entry
+	//these are mostly the in between colors of the smaller mip levels
+	std::vector< std::pair<int, Uint32> > byCount;
+	for( const std::pair<const Uint32, int> &entry : counts )
+		byCount.push_back( std::make_pair( -entry.second, entry.first ) );
+	std::sort( byCount.begin(), byCount.end() );
+	
+	palette.clear();
+	for( int i = 0; i < (int)byCount.size() && i < TEXTURE_COLORS; i++ )
+		palette.push_back( byCount[i].second );
+	
+	//every color only has to be matched once
+	std::map<Uint32, Uint8> index;
+	for( const std::pair<const Uint32, int> &entry : counts )
+		index[entry.first] = (Uint8)nearest( entry.first );
+	
+	for( int l = 0; l < MIP_LEVELS; l++ ){
+		const PixelImage &level = mips->levels[l];
+		indexed->levels[l].wid = level.wid;
+		indexed->levels[l].hig = level.hig;
+		indexed->levels[l].pixels.resize( level.pixels.size() );
+		for( int i = 0; i < (int)level.pixels.size(); i++ )
+			indexed->levels[l].pixels[i] = index[level.pixels[i] | 0xFF000000u];
+	}
+}
+
+Uint8 ColorMap::add_color( Uint32 color ){
+	
+	color |= 0xFF000000u;
+	
+	for( int i = 0; i < (int)palette.size(); i++ )
+		if( palette[i] == color )
+			return (Uint8)i;
+	
+	if( palette.size() < 256 ){
+		palette.push_back( color );
+		return (Uint8)( palette.size() - 1 );
+	}
+	
+	return (Uint8)nearest( color );
+}
+
+void ColorMap::build_table( int lightLevels_, double darkRatio, Uint32 fogColor ){
+	
+	lightLevels = lightLevels_ > 1 ? lightLevels_ : 2;
+	table.assign( ( lightLevels << 1 ) << 8, 0xFF000000u );
+	
+	for( int side = 0; side < 2; side++ ){
+		
+		double ratio = side ? darkRatio : 1.0;
+		
+		for( int level = 0; level < lightLevels; level++ ){
+			
+			//how far the colors have faded into the fog
+			Uint32 fog = (Uint32)( 255.0*level/( lightLevels - 1 ) + 0.5 );
+			Uint32 *row = &table[( side*lightLevels + level ) << 8];
+			
+			for( int i = 0; i < (int)palette.size(); i++ ){
+				Uint32 color = pack_rgb( (Uint8)( ratio*( ( palette[i] >> 16 ) & 0xFF ) ),
+										(Uint8)( ratio*( ( palette[i] >> 8 ) & 0xFF ) ),
+										(Uint8)( ratio*( palette[i] & 0xFF ) ) );
+				row[i] = blend_pixel( fogColor, color, fog );
+			}
+		}
+	}
+}
@@ -0,0 +1,239 @@
+#include <cmath>
+
+//Refer to this header file for documentation
+#include <FloorCaster.h>
+
+//the row kernel is only built where AVX2 intrinsics can be used
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define FLOOR_AVX2
+#include <immintrin.h>
+#endif
+
+const unsigned BLOCK_DIM = 64;
+
+//columns a column major frame is drawn in at a time, every row is cast across one tile before the next,
+//so that the writes go down the columns of the tile instead of jumping across the whole frame
+const int FLOOR_TILE = 32;
+
+//the texel under a fixed point map position
+static inline Uint32 floor_texel( Uint32 fx, Uint32 fy ){
+	return ( ( ( fy >> 16 ) & ( FLOOR_DIM - 1 ) ) << 6 ) | ( ( fx >> 16 ) & ( FLOOR_DIM - 1 ) );
+}
+
+//pixels from x up to wid, one after the other, pitch apart in the frame
+static void cast_rows_scalar( const FloorRow *row, int x, int wid, const int *wallTop, const int *wallBottom,
+							const Uint32 *floorPixels, const Uint32 *ceilingPixels,
+							const Uint8 *floorIndexed, const Uint8 *ceilingIndexed,
+							Uint32 *floorDst, Uint32 *ceilDst, int pitch ){
+	
+	Uint32 fx = row->fx + row->dfx*(Uint32)x;
+	Uint32 fy = row->fy + row->dfy*(Uint32)x;
+	
+	for( ; x < wid; x++, fx += row->dfx, fy += row->dfy ){
+		
+		Uint32 texel = floor_texel( fx, fy );
+		
+		if( row->y >= wallBottom[x] )
+			floorDst[x*pitch] = row->shade ? row->shade[floorIndexed[texel]] : floorPixels[texel];
+		if( row->yc < wallTop[x] )
+			ceilDst[x*pitch] = row->shade ? row->shade[ceilingIndexed[texel]] : ceilingPixels[texel];
+	}
+}
+
+#ifdef FLOOR_AVX2
+
+//writes the pixels of color that show, pitch apart, a column major frame has no 8 pixels of a row together
+__attribute__((target("avx2")))
+static inline void store_shown( Uint32 *dst, int pitch, __m256i show, __m256i color ){
+	
+	if( pitch == 1 ){
+		_mm256_maskstore_epi32( (int*)dst, show, color );
+		return;
+	}
+	
+	Uint32 colors[8];
+	_mm256_storeu_si256( (__m256i*)colors, color );
+	int shown = _mm256_movemask_ps( _mm256_castsi256_ps( show ) );
+	for( int k = 0; k < 8; k++ )
+		if( shown & ( 1 << k ) )
+			dst[k*pitch] = colors[k];
+}
+
+//pixels from x up to wid, 8 at a time, the texels are gathered and only written where the wall
+//doesn't cover them. Returns the first pixel it didn't get to
+__attribute__((target("avx2")))
+static int cast_rows_avx2( const FloorRow *row, int x, int wid, const int *wallTop, const int *wallBottom,
+						const Uint32 *floorPixels, const Uint32 *ceilingPixels,
+						const Uint8 *floorIndexed, const Uint8 *ceilingIndexed,
+						Uint32 *floorDst, Uint32 *ceilDst, int pitch ){
+	
+	const __m256i lane = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+	const __m256i mask = _mm256_set1_epi32( FLOOR_DIM - 1 );
+	const __m256i low = _mm256_set1_epi32( 0xFF );
+	
+	Uint32 startX = row->fx + row->dfx*(Uint32)x;
+	Uint32 startY = row->fy + row->dfy*(Uint32)x;
+	__m256i fx = _mm256_add_epi32( _mm256_set1_epi32( (int)startX ), _mm256_mullo_epi32( lane, _mm256_set1_epi32( (int)row->dfx ) ) );
+	__m256i fy = _mm256_add_epi32( _mm256_set1_epi32( (int)startY ), _mm256_mullo_epi32( lane, _mm256_set1_epi32( (int)row->dfy ) ) );
+	const __m256i stepX = _mm256_set1_epi32( (int)( row->dfx << 3 ) );
+	const __m256i stepY = _mm256_set1_epi32( (int)( row->dfy << 3 ) );
+	
+	//the floor row shows where it's at or below the bottom of the wall, the ceiling row where it's above the top
+	const __m256i floorY = _mm256_set1_epi32( row->y + 1 );
+	const __m256i ceilY = _mm256_set1_epi32( row->yc );
+	
+	for( ; x + 8 <= wid; x += 8 ){
+		
+		__m256i texel = _mm256_or_si256( _mm256_slli_epi32( _mm256_and_si256( _mm256_srli_epi32( fy, 16 ), mask ), 6 ),
+										_mm256_and_si256( _mm256_srli_epi32( fx, 16 ), mask ) );
+		fx = _mm256_add_epi32( fx, stepX );
+		fy = _mm256_add_epi32( fy, stepY );
+		
+		__m256i floorShow = _mm256_cmpgt_epi32( floorY, _mm256_loadu_si256( (const __m256i*)( wallBottom + x ) ) );
+		__m256i ceilShow = _mm256_cmpgt_epi32( _mm256_loadu_si256( (const __m256i*)( wallTop + x ) ), ceilY );
+		
+		if( !_mm256_testz_si256( floorShow, floorShow ) ){
+			__m256i color;
+			if( row->shade ){
+				__m256i index = _mm256_and_si256( _mm256_i32gather_epi32( (const int*)floorIndexed, texel, 1 ), low );
+				color = _mm256_i32gather_epi32( (const int*)row->shade, index, 4 );
+			}else
+				color = _mm256_i32gather_epi32( (const int*)floorPixels, texel, 4 );
+			store_shown( floorDst + x*pitch, pitch, floorShow, color );
+		}
+		
+		if( !_mm256_testz_si256( ceilShow, ceilShow ) ){
+			__m256i color;
+			if( row->shade ){
+				__m256i index = _mm256_and_si256( _mm256_i32gather_epi32( (const int*)ceilingIndexed, texel, 1 ), low );
+				color = _mm256_i32gather_epi32( (const int*)row->shade, index, 4 );
+			}else
+				color = _mm256_i32gather_epi32( (const int*)ceilingPixels, texel, 4 );
+			store_shown( ceilDst + x*pitch, pitch, ceilShow, color );
+		}
+	}
+	
+	return x;
+}
+
+#endif
+
+bool floor_simd_supported(){
+#ifdef FLOOR_AVX2
+	return SDL_HasAVX2() == SDL_TRUE;
+#else
+	return false;
+#endif
+}
+
+void FloorCaster::load_textures( const PixelImage *wall_pixels, const IndexedMips *wall_indexed,
+								int floorTexture, int ceilingTexture ){
+	
+	floorPixels.resize( FLOOR_DIM*FLOOR_DIM );
+	ceilingPixels.resize( FLOOR_DIM*FLOOR_DIM );
+	floorIndexed.assign( FLOOR_DIM*FLOOR_DIM + 3, 0 );
+	ceilingIndexed.assign( FLOOR_DIM*FLOOR_DIM + 3, 0 );
+	
+	//the indexed strip is transposed, texel (u, v) of the strip is at u*wid + v
+	const IndexedImage *indexed = &wall_indexed->levels[0];
+	
+	for( int v = 0; v < FLOOR_DIM; v++ )
+		for( int u = 0; u < FLOOR_DIM; u++ ){
+			int floorU = floorTexture*FLOOR_DIM + u, ceilingU = ceilingTexture*FLOOR_DIM + u;
+			floorPixels[v*FLOOR_DIM + u] = wall_pixels->pixels[v*wall_pixels->wid + floorU];
+			ceilingPixels[v*FLOOR_DIM + u] = wall_pixels->pixels[v*wall_pixels->wid + ceilingU];
+			floorIndexed[v*FLOOR_DIM + u] = indexed->pixels[floorU*indexed->wid + v];
+			ceilingIndexed[v*FLOOR_DIM + u] = indexed->pixels[ceilingU*indexed->wid + v];
+		}
+}
+
+void FloorCaster::draw( FrameBuffer *frame, double posX, double posY, double ang, Camera *cam,
+						const HitBuffer &hits, const ColorMap *colormap, double fogDist ){
+	
+	if( floorPixels.empty() )
+		return;
+	
+	int wid = cam->wid < frame->wid ? cam->wid : frame->wid;
+	int hig = cam->hig < frame->hig ? cam->hig : frame->hig;
+	double screenDist = cam->screenDist;
+	
+	//the rows the walls take up, worked out the same way castRays does
+	wallTop.resize( wid );
+	wallBottom.resize( wid );
+	for( int i = 0; i < wid; i++ ){
+		if( hits.dist[i] == 0.0 || hits.cell[i] < 0 ){
+			wallTop[i] = wallBottom[i] = hig >> 1;
+			continue;
+		}
+		double rayHig = ( (double)BLOCK_DIM*screenDist )/hits.dist[i];
+		int h = rayHig > hig ? hig : (int)rayHig;
+		wallTop[i] = ( hig - h ) >> 1;
+		wallBottom[i] = wallTop[i] + h;
+	}
+	
+	//the view direction, and the direction the screen runs to the left in
+	double dirX = std::cos( ang ), dirY = -std::sin( ang );
+	double leftX = -std::sin( ang ), leftY = -std::cos( ang );
+	
+#ifdef FLOOR_AVX2
+	static bool simd = floor_simd_supported();
+#endif
+	
+	rows.clear();
+	
+	for( int y = ( hig + 1 ) >> 1; y < hig; y++ ){
+		
+		//distance to the floor under the middle of this row, the eye is half a block up
+		double p = y + 0.5 - 0.5*hig;
+		double dist = 0.5*BLOCK_DIM*screenDist/p;
+		
+		//map position under the first column, and how much it moves from one column to the next
+		double tanFirst = (double)( wid >> 1 )/screenDist;
+		double firstX = posX + dist*( dirX + tanFirst*leftX );
+		double firstY = posY + dist*( dirY + tanFirst*leftY );
+		double stepX = -dist*leftX/screenDist, stepY = -dist*leftY/screenDist;
+		
+		FloorRow row;
+		//through a 64 bit integer first, far rows lie well outside the range of 16.16
+		row.fx = (Uint32)(Sint64)std::floor( firstX*65536.0 );
+		row.fy = (Uint32)(Sint64)std::floor( firstY*65536.0 );
+		row.dfx = (Uint32)(Sint64)std::floor( stepX*65536.0 );
+		row.dfy = (Uint32)(Sint64)std::floor( stepY*65536.0 );
+		row.y = y;
+		row.yc = hig - 1 - y;
+		
+		row.shade = NULL;
+		if( colormap != NULL ){
+			int fog = colormap->lightLevels - 1;
+			if( dist < fogDist )
+				fog = (int)( dist*( colormap->lightLevels - 1 )/fogDist );
+			row.shade = colormap->shade( false, fog );
+		}
+		
+		rows.push_back( row );
+	}
+	
+	//the pixels of a row lie pitchX apart, next to each other unless the frame is column major
+	//then the rows are cast one tile of columns at a time
+	int tile = frame->pitchX == 1 ? wid : FLOOR_TILE;
+	
+	for( int x0 = 0; x0 < wid; x0 += tile ){
+		
+		int x1 = x0 + tile < wid ? x0 + tile : wid;
+		
+		for( const FloorRow &row : rows ){
+			
+			Uint32 *floorDst = &frame->pixels[row.y*frame->pitchY];
+			Uint32 *ceilDst = &frame->pixels[row.yc*frame->pitchY];
+			
+			int x = x0;
+#ifdef FLOOR_AVX2
+			if( simd )
+				x = cast_rows_avx2( &row, x, x1, wallTop.data(), wallBottom.data(), floorPixels.data(), ceilingPixels.data(),
+									floorIndexed.data(), ceilingIndexed.data(), floorDst, ceilDst, frame->pitchX );
+#endif
+			cast_rows_scalar( &row, x, x1, wallTop.data(), wallBottom.data(), floorPixels.data(), ceilingPixels.data(),
+							floorIndexed.data(), ceilingIndexed.data(), floorDst, ceilDst, frame->pitchX );
+		}
+	}
+}
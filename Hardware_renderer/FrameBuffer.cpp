@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+//Refer to this header file for documentation
+#include <FrameBuffer.h>
+#include <ColumnScaler.h>
+
+//the transpose is only built with AVX2 where its intrinsics can be used
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define TRANSPOSE_AVX2
+#include <immintrin.h>
+#endif
+
+//side of the blocks the pixels are transposed in
+const int TRANSPOSE_BLOCK = 8;
+
+bool load_pixels( SDL_Surface *surface, PixelImage *image ){
+	
+	SDL_Surface *argb = SDL_ConvertSurfaceFormat( surface, SDL_PIXELFORMAT_ARGB8888, 0 );
+	
+	if( argb == NULL ){
+		printf( "Surface couldnt be converted. SDL error: %s\n", SDL_GetError() );
+		return false;
+	}
+	
+	image->wid = argb->w;
+	image->hig = argb->h;
+	image->pixels.resize( argb->w*argb->h );
+	
+	SDL_LockSurface( argb );
+	for( int i = 0; i < argb->h; i++ ){
+		Uint32 *row = (Uint32*)( (Uint8*)argb->pixels + i*argb->pitch );
+		for( int j = 0; j < argb->w; j++ )
+			image->pixels[i*argb->w + j] = row[j] | 0xFF000000u;
+	}
+	SDL_UnlockSurface( argb );
+	
+	SDL_FreeSurface( argb );
+	
+	return true;
+}
+
+void transpose_pixels( const PixelImage *image, PixelImage *columns ){
+	
+	columns->wid = image->hig;
+	columns->hig = image->wid;
+	columns->pixels.resize( image->wid*image->hig );
+	
+	for( int i = 0; i < image->hig; i++ )
+		for( int j = 0; j < image->wid; j++ )
+			columns->pixels[j*columns->wid + i] = image->pixels[i*image->wid + j];
+}
+
+//averages every 2x2 block of texels of image into one texel of half
+static void halve_pixels( const PixelImage *image, PixelImage *half ){
+	
+	half->wid = image->wid > 1 ? image->wid >> 1 : 1;
+	half->hig = image->hig > 1 ? image->hig >> 1 : 1;
+	half->pixels.resize( half->wid*half->hig );
+	
+	for( int i = 0; i < half->hig; i++ )
+		for( int j = 0; j < half->wid; j++ ){
+			
+			//the texels that get averaged, repeated on a side that can't be halved any more
+			int i0 = image->hig > 1 ? i << 1 : i, i1 = image->hig > 1 ? i0 + 1 : i0;
+			int j0 = image->wid > 1 ? j << 1 : j, j1 = image->wid > 1 ? j0 + 1 : j0;
+			Uint32 texel[4] = { image->pixels[i0*image->wid + j0], image->pixels[i0*image->wid + j1],
+								image->pixels[i1*image->wid + j0], image->pixels[i1*image->wid + j1] };
+			
+			//every channel summed on its own, rounded to nearest
+			Uint32 r = 2, g = 2, b = 2;
+			for( int k = 0; k < 4; k++ ){
+				r += ( texel[k] >> 16 ) & 0xFF;
+				g += ( texel[k] >> 8 ) & 0xFF;
+				b += texel[k] & 0xFF;
+			}
+			half->pixels[i*half->wid + j] = pack_rgb( r >> 2, g >> 2, b >> 2 );
+		}
+}
+
+void build_mips( const PixelImage *image, MipChain *mips ){
+	
+	//the halving is done on row major images, each level is transposed once it's done
+	PixelImage level = *image, next;
+	
+	for( int i = 0; i < MIP_LEVELS; i++ ){
+		transpose_pixels( &level, &mips->levels[i] );
+		if( i + 1 < MIP_LEVELS ){
+			halve_pixels( &level, &next );
+			level.wid = next.wid; level.hig = next.hig;
+			level.pixels.swap( next.pixels );
+		}
+	}
+}
+
+FrameBuffer::FrameBuffer(){
+	texture = NULL;
+	wid = hig = 0;
+	columnMajor = false;
+	set_layout( false );
+}
+
+FrameBuffer::~FrameBuffer(){
+	if( texture != NULL )
+		SDL_DestroyTexture( texture );
+}
+
+bool FrameBuffer::resize( SDL_Renderer *renderer, int wid_, int hig_ ){
+	
+	if( texture != NULL && wid_ == wid && hig_ == hig )
+		return true;
+	
+	if( texture != NULL )
+		SDL_DestroyTexture( texture );
+	
+	wid = wid_; hig = hig_;
+	pixels.assign( wid*hig, 0xFF000000u );
+	set_layout( columnMajor );
+	
+	texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, wid, hig );
+	
+	if( texture == NULL ){
+		printf( "Frame buffer texture couldnt be created. SDL error: %s\n", SDL_GetError() );
+		return false;
+	}
+	
+	//the frame covers the whole screen, nothing underneath it shows through
+	SDL_SetTextureBlendMode( texture, SDL_BLENDMODE_NONE );
+	
+	return true;
+}
+
+void FrameBuffer::set_layout( bool columnMajor_ ){
+	
+	columnMajor = columnMajor_;
+	
+	//the times of one layout and size say nothing about another
+	transposeTime = uploadTime = 0.0;
+	presents = 0;
+	
+	if( columnMajor ){
+		pitchX = hig; pitchY = 1;
+	}else{
+		pitchX = 1; pitchY = wid;
+	}
+}
+
+void FrameBuffer::fill_rows( int y0, int y1, Uint32 color ){
+	
+	y0 = y0 < 0 ? 0 : y0;
+	y1 = y1 > hig ? hig : y1;
+	
+	if( y1 <= y0 )
+		return;
+	
+	if( !columnMajor )
+		std::fill( pixels.begin() + y0*wid, pixels.begin() + y1*wid, color );
+	else{
+		//the same part of every column
+		for( int x = 0; x < wid; x++ )
+			std::fill( pixels.begin() + x*hig + y0, pixels.begin() + x*hig + y1, color );
+	}
+}
+
+void FrameBuffer::fill_column( int x, int y, int h, Uint32 color, Uint8 alpha ){
+	
+	if( x < 0 || x >= wid )
+		return;
+	
+	int y0 = y < 0 ? 0 : y;
+	int y1 = y + h > hig ? hig : y + h;
+	
+	Uint32 *dst = &pixels[x*pitchX + y0*pitchY];
+	
+	if( alpha == 255 ){
+		for( int i = y0; i < y1; i++, dst += pitchY )
+			*dst = color;
+	}else{
+		for( int i = y0; i < y1; i++, dst += pitchY )
+			*dst = blend_pixel( color, *dst, alpha );
+	}
+}
+
+void FrameBuffer::draw_column( int x, int y, int h, const PixelImage *columns, int srcX, int srcY, int srcH, Uint8 alpha ){
+	
+	if( x < 0 || x >= wid || h <= 0 )
+		return;
+	
+	int y0 = y < 0 ? 0 : y;
+	int y1 = y + h > hig ? hig : y + h;
+	
+	//texel row in 16.16 fixed point, stepped once per pixel
+	Uint32 step = ( (Uint32)srcH << 16 )/(Uint32)h;
+	Uint32 texY = ( (Uint32)srcY << 16 ) + step*(Uint32)( y0 - y );
+	
+	//the whole texel column lies in one run of memory
+	const Uint32 *src = &columns->pixels[srcX*columns->wid];
+	Uint32 *dst = &pixels[x*pitchX + y0*pitchY];
+	
+	if( alpha == 255 ){
+		DirectTexels texels = { src };
+		scale_column( dst, pitchY, y1 - y0, texels, texY, step );
+	}else{
+		for( int i = y0; i < y1; i++, dst += pitchY, texY += step )
+			*dst = blend_pixel( src[texY >> 16], *dst, alpha );
+	}
+}
+
+void FrameBuffer::draw_indexed_column( int x, int y, int h, const IndexedImage *columns, int srcX, int srcY, int srcH,
+									const Uint32 *shade, Uint8 alpha ){
+	
+	if( x < 0 || x >= wid || h <= 0 )
+		return;
+	
+	int y0 = y < 0 ? 0 : y;
+	int y1 = y + h > hig ? hig : y + h;
+	
+	Uint32 step = ( (Uint32)srcH << 16 )/(Uint32)h;
+	Uint32 texY = ( (Uint32)srcY << 16 ) + step*(Uint32)( y0 - y );
+	
+	const Uint8 *src = &columns->pixels[srcX*columns->wid];
+	Uint32 *dst = &pixels[x*pitchX + y0*pitchY];
+	
+	if( alpha == 255 ){
+		ShadedTexels texels = { src, shade };
+		scale_column( dst, pitchY, y1 - y0, texels, texY, step );
+	}else{
+		for( int i = y0; i < y1; i++, dst += pitchY, texY += step )
+			*dst = blend_pixel( shade[src[texY >> 16]], *dst, alpha );
+	}
+}
+
+#ifdef TRANSPOSE_AVX2
+
+//transposes an 8x8 block of pixels, src holds 8 columns of 8 pixels srcPitch apart,
+//and they become 8 rows of dst, dstPitch apart
+__attribute__((target("avx2")))
+static void transpose_block_avx2( const Uint32 *src, int srcPitch, Uint32 *dst, int dstPitch ){
+	
+	__m256i r[8], t[8], u[8];
+	
+	for( int i = 0; i < 8; i++ )
+		r[i] = _mm256_loadu_si256( (const __m256i*)( src + i*srcPitch ) );
+	
+	//pairs of pixels from neighbouring columns, then groups of four, then the two halves are swapped over
+	for( int i = 0; i < 8; i += 2 ){
+		t[i] = _mm256_unpacklo_epi32( r[i], r[i + 1] );
+		t[i + 1] = _mm256_unpackhi_epi32( r[i], r[i + 1] );
+	}
+	for( int i = 0; i < 8; i += 4 ){
+		u[i] = _mm256_unpacklo_epi64( t[i], t[i + 2] );
+		u[i + 1] = _mm256_unpackhi_epi64( t[i], t[i + 2] );
+		u[i + 2] = _mm256_unpacklo_epi64( t[i + 1], t[i + 3] );
+		u[i + 3] = _mm256_unpackhi_epi64( t[i + 1], t[i + 3] );
+	}
+	for( int i = 0; i < 4; i++ ){
+		_mm256_storeu_si256( (__m256i*)( dst + i*dstPitch ), _mm256_permute2x128_si256( u[i], u[i + 4], 0x20 ) );
+		_mm256_storeu_si256( (__m256i*)( dst + ( i + 4 )*dstPitch ), _mm256_permute2x128_si256( u[i], u[i + 4], 0x31 ) );
+	}
+}
+
+#endif
+
+bool transpose_simd_supported(){
+#ifdef TRANSPOSE_AVX2
+	return SDL_HasAVX2() == SDL_TRUE;
+#else
+	return false;
+#endif
+}
+
+void FrameBuffer::transpose_to( Uint32 *dst, int dstPitch ){
+	
+#ifdef TRANSPOSE_AVX2
+	static bool simd = transpose_simd_supported();
+#endif
+	
+	//whole blocks first, a band of rows at a time, so that the texture is written front to back
+	//and every column is read in steps of a block
+	int blockWid = wid - wid % TRANSPOSE_BLOCK, blockHig = hig - hig % TRANSPOSE_BLOCK;
+	
+	for( int y = 0; y < blockHig; y += TRANSPOSE_BLOCK )
+		for( int x = 0; x < blockWid; x += TRANSPOSE_BLOCK ){
+			
+			const Uint32 *src = &pixels[x*hig + y];
+			Uint32 *out = dst + y*dstPitch + x;
+			
+#ifdef TRANSPOSE_AVX2
+			if( simd ){
+				transpose_block_avx2( src, hig, out, dstPitch );
+				continue;
+			}
+#endif
+			for( int i = 0; i < TRANSPOSE_BLOCK; i++ )
+				for( int j = 0; j < TRANSPOSE_BLOCK; j++ )
+					out[j*dstPitch + i] = src[i*hig + j];
+		}
+	
+	//then the rows below the last whole block, and the columns right of it
+	for( int x = 0; x < wid; x++ ){
+		int y0 = x < blockWid ? blockHig : 0;
+		for( int y = y0; y < hig; y++ )
+			dst[y*dstPitch + x] = pixels[x*hig + y];
+	}
+}
+
+void FrameBuffer::present( SDL_Renderer *renderer ){
+	
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	//one upload and one draw call for the whole 3D view
+	if( !columnMajor ){
+		SDL_UpdateTexture( texture, NULL, pixels.data(), wid*sizeof(Uint32) );
+		
+	}else{
+		//the pixels are turned round straight into the texture's memory
+		void *locked;
+		int pitch;
+		if( SDL_LockTexture( texture, NULL, &locked, &pitch ) == 0 ){
+			transpose_to( (Uint32*)locked, pitch/(int)sizeof(Uint32) );
+			std::chrono::steady_clock::time_point turned = std::chrono::steady_clock::now();
+			transposeTime += std::chrono::duration_cast<std::chrono::microseconds>( turned - start ).count()*0.000001;
+			start = turned;
+			SDL_UnlockTexture( texture );
+		}
+	}
+	
+	uploadTime += std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - start ).count()*0.000001;
+	presents++;
+	
+	SDL_RenderCopy( renderer, texture, NULL, NULL );
+}
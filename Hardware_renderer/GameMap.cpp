@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <cmath>
 #include <string>
+#include <algorithm>
 #define PI 3.1415926535897932384
 
 //Refer to this header file for documentation
@@ -9,10 +10,12 @@
 
 //creates the game map by importing a bitmap file
 //uses SDL's internal mechanisms to read the bitmap file and create the map array
-GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *dark_wall_textures, double wallColorRatio){
+GameMap::GameMap(SDL_Surface *mapImg, const WallTextures *textures, ColorMap *colormap, double wallColorRatio){
 	
-	//default is 16, can't be changed as of now
-	mapZoom = 16;
+	//the closest zoom, blocks are drawn at half size
+	mapZoom = 0;
+	
+	wallTextures = *textures;
 	
 	//If an error occurs
 	if( mapImg == NULL ){
@@ -26,6 +29,7 @@ GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *d
 	
 	//initializing the main map array
 	mapArr = new Block*[mapDims[0]*mapDims[1]];
+	cellMaterials.assign( mapDims[0]*mapDims[1], 0 );
 	
 	//initializing the wall counts
 	H_WALL_CNT = mapDims[0] + 1;
@@ -69,16 +73,26 @@ GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *d
 			
 			Block *newBlock = NULL;
 			
+			//how the walls of this block look
+			Material material;
+			
 			if( is_textured ){
 				
 				//converting the color into an offset
 				color -= 5;
 				
 				//creating a textured block
-				newBlock = new TextureBlock( wall_textures, dark_wall_textures, color );
+				TextureBlock *textureBlock = new TextureBlock( wallTextures.wall, color );
+				newBlock = textureBlock;
 				
 				for( int k = 0; k < 3; k++ )
 					newBlock->colors[k] = colors[k];
+				
+				material.kind = MATERIAL_TEXTURE;
+				material.textureOffset = textureBlock->texture_offset;
+				material.paletteIndex = 0;
+				for( int k = 0; k < 3; k++ )
+					material.colors[k] = material.dark_colors[k] = 0;
 			
 			}else{
 				
@@ -90,7 +104,7 @@ GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *d
 				}
 				
 				//creating a colored block
-				newBlock = new ColorBlock( colors[0], colors[1], colors[2], false, wallColorRatio );
+				newBlock = new ColorBlock( colors[0], colors[1], colors[2], false );
 				
 				for( int k = 0; k < 3; k++ ){
 					
@@ -102,19 +116,34 @@ GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *d
 						//when draw distance is reached, a full black isn't displayed
 						newBlock->colors[k] = 50;
 				}
+				
+				material.kind = MATERIAL_COLOR;
+				material.textureOffset = 0;
+				for( int k = 0; k < 3; k++ ){
+					material.colors[k] = newBlock->colors[k];
+					material.dark_colors[k] = (Uint8)( wallColorRatio*colors[k] );
+				}
+				
+				material.paletteIndex = 0;
+				if( newBlock->isWall && colormap != NULL )
+					material.paletteIndex = colormap->add_color( pack_rgb( colors[0], colors[1], colors[2] ) );
 			}
 			
 			mapArr[i*mapDims[1] + (int)(j/3)] = newBlock;
+			if( newBlock->isWall )
+				cellMaterials[i*mapDims[1] + (int)(j/3)] = find_material( material );
 		}
 	}
 	
 	//initializing these two arrays with empty blocks
 	for( int i = 0; i < mapDims[0]*V_WALL_CNT; i++ ){
-		mapVLines[i] = new ColorBlock(wallColorRatio);
+		mapVLines[i] = new ColorBlock();
 	}
 	for( int i = 0; i < mapDims[1]*H_WALL_CNT; i++ ){
-		mapHLines[i] = new ColorBlock(wallColorRatio);
+		mapHLines[i] = new ColorBlock();
 	}
+	vLineCells.assign( mapDims[0]*V_WALL_CNT, -1 );
+	hLineCells.assign( mapDims[1]*H_WALL_CNT, -1 );
 	
 	//setting walls around solid blocks as solid walls
 	//if the wall is around an empty block, nothing is done
@@ -128,6 +157,109 @@ GameMap::GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *d
 				
 				mapHLines[mapDims[1]*i + j] = mapArr[i*mapDims[1] + j];
 				mapHLines[mapDims[1]*(i + 1) + j] = mapArr[i*mapDims[1] + j];
+				
+				vLineCells[V_WALL_CNT*i + j] = vLineCells[V_WALL_CNT*i + j + 1] = i*mapDims[1] + j;
+				hLineCells[mapDims[1]*i + j] = hLineCells[mapDims[1]*(i + 1) + j] = i*mapDims[1] + j;
+			}
+		}
+	}
+	
+	build_occupancy();
+	build_distance_field();
+}
+
+Uint16 GameMap::find_material( const Material &m ){
+	
+	for( int i = 0; i < (int)materials.size(); i++ ){
+		const Material &o = materials[i];
+		if( o.kind == m.kind && o.textureOffset == m.textureOffset && o.paletteIndex == m.paletteIndex
+			&& o.colors[0] == m.colors[0] && o.colors[1] == m.colors[1] && o.colors[2] == m.colors[2]
+			&& o.dark_colors[0] == m.dark_colors[0] && o.dark_colors[1] == m.dark_colors[1]
+			&& o.dark_colors[2] == m.dark_colors[2] )
+			return (Uint16)i;
+	}
+	
+	materials.push_back( m );
+	return (Uint16)( materials.size() - 1 );
+}
+
+void GameMap::build_occupancy(){
+	
+	//one extra bit on either side of every row, and one extra row above and below
+	blockStride = mapDims[1] + 2;
+	vLineStride = V_WALL_CNT + 2;
+	hLineStride = mapDims[1] + 2;
+	
+	//everything starts out solid, which leaves the solid border behind
+	blockBits.assign( ( blockStride*( mapDims[0] + 2 ) + 31 ) >> 5, 0xFFFFFFFF );
+	vLineBits.assign( ( vLineStride*( mapDims[0] + 2 ) + 31 ) >> 5, 0xFFFFFFFF );
+	hLineBits.assign( ( hLineStride*( H_WALL_CNT + 2 ) + 31 ) >> 5, 0xFFFFFFFF );
+	
+	//clears the bit of an empty block or wall inside the map
+	auto clear = []( std::vector<Uint32> &bits, int stride, int y, int x ){
+		int i = ( y + 1 )*stride + x + 1;
+		bits[i >> 5] &= ~( (Uint32)1 << ( i & 31 ) );
+	};
+	
+	for( int i = 0; i < mapDims[0]; i++ ){
+		for( int j = 0; j < mapDims[1]; j++ ){
+			if( !mapArr[i*mapDims[1] + j]->isWall )
+				clear( blockBits, blockStride, i, j );
+		}
+	}
+	for( int i = 0; i < mapDims[0]; i++ ){
+		for( int j = 0; j < V_WALL_CNT; j++ ){
+			if( !mapVLines[i*V_WALL_CNT + j]->isWall )
+				clear( vLineBits, vLineStride, i, j );
+		}
+	}
+	for( int i = 0; i < H_WALL_CNT; i++ ){
+		for( int j = 0; j < mapDims[1]; j++ ){
+			if( !mapHLines[i*mapDims[1] + j]->isWall )
+				clear( hLineBits, hLineStride, i, j );
+		}
+	}
+}
+
+void GameMap::build_distance_field(){
+	
+	int rows = mapDims[0] + 2;
+	
+	//breadth first search outwards from every solid block at once, including the solid border
+	//moving to any of the 8 neighbours gives exactly the Chebyshev distance
+	freeDist.assign( blockStride*rows, 255 );
+	std::vector<int> queue;
+	
+	for( int i = 0; i < rows; i++ ){
+		for( int j = 0; j < blockStride; j++ ){
+			if( test_bit( blockBits, blockStride, i - 1, j - 1 ) ){
+				freeDist[i*blockStride + j] = 0;
+				queue.push_back( i*blockStride + j );
+			}
+		}
+	}
+	
+	for( int q = 0; q < (int)queue.size(); q++ ){
+		
+		int i = queue[q] / blockStride;
+		int j = queue[q] % blockStride;
+		int next = freeDist[queue[q]] + 1;
+		
+		//far away blocks just keep the max value
+		if( next >= 255 )
+			continue;
+		
+		for( int di = -1; di <= 1; di++ ){
+			for( int dj = -1; dj <= 1; dj++ ){
+				
+				int ni = i + di, nj = j + dj;
+				if( ni < 0 || ni >= rows || nj < 0 || nj >= blockStride )
+					continue;
+				
+				if( freeDist[ni*blockStride + nj] > next ){
+					freeDist[ni*blockStride + nj] = next;
+					queue.push_back( ni*blockStride + nj );
+				}
 			}
 		}
 	}
@@ -155,6 +287,49 @@ Block* GameMap::vert_wall_at( int y, int x ){
 		return NULL;
 }
 
+int GameMap::vert_wall_cell( int y, int x ) const {
+	if( x >= 0 && x < V_WALL_CNT && y >= 0 && y < mapDims[0] )
+		return vLineCells[y*V_WALL_CNT + x];
+	else
+		return -1;
+}
+
+int GameMap::horiz_wall_cell( int y, int x ) const {
+	if( x >= 0 && x < mapDims[1] && y >= 0 && y < H_WALL_CNT )
+		return hLineCells[y*mapDims[1] + x];
+	else
+		return -1;
+}
+
+void GameMap::mark_seen( const int *cells, int count ){
+	
+	//neighbouring columns mostly hit the same block, it's only marked once for them
+	//blocks seen for the first time go into the map pyramid with the next top down view
+	int last = -1;
+	for( int i = 0; i < count; i++ ){
+		if( cells[i] >= 0 && cells[i] != last && !mapArr[cells[i]]->seen ){
+			mapArr[cells[i]]->seen = true;
+			newlySeen.push_back( cells[i] );
+		}
+		last = cells[i];
+	}
+}
+
+void GameMap::redraw_seen(){
+	
+	newlySeen.clear();
+	for( int i = 0; i < mapDims[0]*mapDims[1]; i++ )
+		if( mapArr[i]->seen )
+			newlySeen.push_back( i );
+}
+
+void GameMap::zoom_2d_map( int steps ){
+	
+	mapZoom += steps;
+	if( mapZoom < 0 ) mapZoom = 0;
+	if( mapZoom >= MAP_LEVELS ) mapZoom = MAP_LEVELS - 1;
+}
+
 bool GameMap::solid_block_at( int y, int x ){
 	if( x >= 0 && x < mapDims[1] && y >= 0 && y < mapDims[0] )
 		return mapArr[y*mapDims[1] + x]->isWall;
@@ -230,52 +405,36 @@ void GameMap::printMap(){
 }*/
 
 //center the display at posX, posY
-void GameMap::draw2DMap(SDL_Renderer *renderer, int posX, int posY){
-	
-	//map positions of given surface at which this display should be centered
-	int mapX = posX >> TILESHIFT;
-	int mapY = posY >> TILESHIFT;
-	
-	//The posX, posY lies inside a block. The offsets are for how far away from the center of the screen the 
-	//top let corner of said block will lie on the screen (after some processing)
+void GameMap::draw2DMap(SDL_Renderer *renderer, Camera *cam, MapPyramid *pyramid, int posX, int posY){
 	
-	//right now xoffs and yoffs are distances from the posX and posY to the block's top left corner
-	int xOffs = (posX - (mapX << TILESHIFT) );
-	int yOffs = (posY - (mapY << TILESHIFT) );
+	int wid = cam->wid, hig = cam->hig;
 	
-	//the bounds of the map portion that will be displayed on the screen
-	int mapxL, mapxH, mapyL, mapyH;
+	//size of a block on the screen at this zoom, half size at the closest one
+	int blockDim = MAP_BLOCK_PIXELS >> mapZoom;
 	
-	//the bounds are decided by the amount of zoom
-	mapxL = mapX - mapZoom; mapyL = mapY - mapZoom;
-	mapxH = mapX + mapZoom; mapyH = mapY + mapZoom;
+	//where the top left corner of the screen lies on the map, in screen pixels
+	int viewX = ( ( posX*blockDim ) >> TILESHIFT ) - ( wid >> 1 );
+	int viewY = ( ( posY*blockDim ) >> TILESHIFT ) - ( hig >> 1 );
 	
-	//if zooming takes us out of bounds, cap it to min/max
-	if( mapxL < 0 ) mapxL = 0;
-	if( mapxH >= mapDims[1] ) mapxH = mapDims[1] - 1;
-	if( mapyL < 0 ) mapyL = 0;
-	if( mapyH >= mapDims[0] ) mapyH = mapDims[0] - 1;
-	
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
-	
-	//to center xOffs and yOffs on the screen
-	//now, xoffs and yoffs are only offsets of the block in which posX and posY lie
-	xOffs = ((wid - xOffs) >> 1);// - xOffs;
-	yOffs = ((hig - yOffs) >> 1);// - yOffs;
+	if( pyramid != NULL ){
+		//only the blocks seen since the last time are drawn, then the screen is copied from the pages
+		pyramid->update( renderer, this, newlySeen );
+		newlySeen.clear();
+		pyramid->draw( renderer, mapZoom, viewX, viewY, wid, hig );
+		return;
+	}
 	
-	//we have to subract the lengths of the blocks that will lie to the left and top of the posX, posY block
-	//to get the offset of the first block that will be drawn onto the screen.
-	xOffs -= (mapX - mapxL) << (TILESHIFT - 1);
-	yOffs -= (mapY - mapyL) << (TILESHIFT - 1);
+	//the blocks on the screen, capped to the map
+	int mapxL = std::max( viewX, 0 )/blockDim, mapxH = std::min( ( viewX + wid - 1 )/blockDim, mapDims[1] - 1 );
+	int mapyL = std::max( viewY, 0 )/blockDim, mapyH = std::min( ( viewY + hig - 1 )/blockDim, mapDims[0] - 1 );
 	
 	for( int i = mapyL; i <= mapyH; i++ ){
 		for( int j = mapxL; j <= mapxH; j++ ){
 			
 			SDL_Rect blockRect;
-			blockRect.x = xOffs + ((j - mapxL) << (TILESHIFT - 1));
-			blockRect.y = yOffs + ((i - mapyL) << (TILESHIFT - 1));
-			blockRect.w = BLOCK_DIM >> 1; blockRect.h = BLOCK_DIM >> 1;
+			blockRect.x = j*blockDim - viewX;
+			blockRect.y = i*blockDim - viewY;
+			blockRect.w = blockDim; blockRect.h = blockDim;
 			
 			//the block will handle the drawing
 			mapArr[i*mapDims[1] + j]->blit_wall_to_2d_screen( renderer, &blockRect );
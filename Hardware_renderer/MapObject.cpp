@@ -6,7 +6,6 @@
 
 const unsigned TILESHIFT = 6;
 const unsigned BLOCK_DIM = 64;
-const int DEPTH_OF_FIELD = 20;
 
 
 
@@ -20,8 +19,10 @@ int MapObject::move(GameMap *gMap, std::vector<MapObject*> &agent_arr, double dx
 	if( rotate ){
 		//projecting motion in object's reference frame axes to grid axes
 		//done for player input
-		moveX = std::cos(ang)*dx + std::sin(ang)*dy;
-		moveY = -std::sin(ang)*dx + std::cos(ang)*dy;
+		bam_t bam = rad_to_bam( ang );
+		double cosAng = bam_cos( bam ), sinAng = bam_sin( bam );
+		moveX = cosAng*dx + sinAng*dy;
+		moveY = -sinAng*dx + cosAng*dy;
 	}
 	
 	if( moveX == 0.0 && moveY == 0.0 )
@@ -114,15 +115,14 @@ Player::Player(double x_, double y_, double ang_, int objDim_){
 Player::Player() : Player::Player(0, 0, 0, 10) {}
 
 //draws at the center of the screen
-void Player::sprite2D(SDL_Renderer *renderer){
+void Player::sprite2D(SDL_Renderer *renderer, Camera *cam, int zoom){
 	
 	SDL_Rect playRect;
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
-	//objDim/4 is done because top-down view is drawn at half size
-	playRect.x = ( ( wid ) >> 1 ) - ( objDim >> 2 );
-	playRect.y = ( ( hig ) >> 1 ) - ( objDim >> 2 );
-	playRect.w = objDim >> 1; playRect.h = objDim >> 1;
+	int wid = cam->wid, hig = cam->hig;
+	//objDim/4 is done because top-down view is drawn at half size, and halved again for every zoom level
+	playRect.x = ( ( wid ) >> 1 ) - ( objDim >> ( 2 + zoom ) );
+	playRect.y = ( ( hig ) >> 1 ) - ( objDim >> ( 2 + zoom ) );
+	playRect.w = objDim >> ( 1 + zoom ); playRect.h = objDim >> ( 1 + zoom );
 	
 	SDL_SetRenderDrawColor( renderer, 255, 255, 0, 255 );
 	SDL_RenderFillRect( renderer, &playRect );
@@ -130,7 +130,7 @@ void Player::sprite2D(SDL_Renderer *renderer){
 	SDL_SetRenderDrawColor( renderer, 255, 0, 0, 255 );
 	SDL_RenderDrawLine( renderer,
 			wid >> 1, hig >> 1,
-			(wid >> 1) + objDim*std::cos(ang), (hig >> 1) - objDim*std::sin(ang) );
+			(wid >> 1) + ( objDim >> zoom )*std::cos(ang), (hig >> 1) - ( objDim >> zoom )*std::sin(ang) );
 	
 }
 
@@ -147,9 +147,10 @@ void Player::double_speed(){}
 //##########################################AGENT##############################################################
 
 //main constructor
-Agent::Agent(SDL_Texture *sprite, double posX, double posY, double ang_, int objDim_,
+Agent::Agent(SDL_Texture *sprite, const PixelImage *spriteColumns_, double posX, double posY, double ang_, int objDim_,
 			int tile_radius_, double speed_, double angVel_){
 	spriteText = sprite;
+	spriteColumns = spriteColumns_;
 	objDim = objDim_;
 	x = posX; y = posY; ang = ang_;
 	tile_radius = tile_radius_;
@@ -196,22 +197,14 @@ bool Agent::check_for_player( GameMap *gMap, MapObject *player ){
 		//double diffX_ = this->player->x - this->x;
 		//double diffY_ = -(this->player->y - this->y);
 		//angle at which ray is casted
-		double rayAng = real_atan( this->diffX_player, -this->diffY_player );
+		bam_t rayAng = bam_atan2( -this->diffY_player, this->diffX_player );
 		
-		//distances from walls
-		double vDist, hDist, finalDist;
-		//placeholders, these are not used at all
-		int a, b, c;
-		cast_vert_ray( gMap, this->x, this->y, rayAng, tile_radius, &a, &b, &vDist, &c );
-		cast_horiz_ray( gMap, this->x, this->y, rayAng, tile_radius, &a, &b, &hDist, &c );
+		//the first wall between the agent and the player, if any
+		RayHit hit;
+		cast_ray( gMap, this->x, this->y, rayAng, (double)( tile_radius << TILESHIFT ), &hit );
 		
-		finalDist = vDist > hDist ? hDist : vDist;
-		
-		//real (map) distance between the agent and the player
-		double real_dist = std::hypot( this->diffX_player, this->diffY_player );
-		
-		//if wall is farther away than the player		
-		has_seen = has_seen ? true : finalDist > real_dist;
+		//if no wall was met, or the wall is farther away than the player
+		has_seen = has_seen ? true : ( !hit.hit || hit.dist > this->diff_hypot );
 	
 	}else if( dist > ( tile_radius << 2 ) )
 		//if the player is too far away, forget that you have seen them
@@ -239,8 +232,9 @@ bool Agent::follow_player(GameMap *gMap, std::vector<MapObject*> &agent_arr, dou
 				return true;
 			
 			//player is at which side of the agent, left or right
-			//first find the difference mod 2PI, then convert it to lie in (-pi, pi)
-			double ang_diff = modPI( mod2PI( real_atan( this->diffX_player, -this->diffY_player ) - this->ang ) );
+			//the difference of the binary angles as a signed number lies in (-pi, pi)
+			bam_t bamAng = rad_to_bam( this->ang );
+			Sint32 ang_diff = (Sint32)( bam_atan2( -this->diffY_player, this->diffX_player ) - bamAng );
 			
 			if( ang_diff > 0 )		//if player is to the left
 				movAng += angVel*dt;
@@ -248,8 +242,8 @@ bool Agent::follow_player(GameMap *gMap, std::vector<MapObject*> &agent_arr, dou
 				movAng -= angVel*dt;
 			
 			//move in the direction of the current angle
-			moveX += std::cos(this->ang)*speed*dt;
-			moveY -= std::sin(this->ang)*speed*dt;
+			moveX += bam_cos(bamAng)*speed*dt;
+			moveY -= bam_sin(bamAng)*speed*dt;
 			
 			//clip the motion
 			int clip = this->move( gMap, agent_arr, moveX, moveY, movAng, false);
@@ -296,10 +290,9 @@ bool Agent::follow_player(GameMap *gMap, std::vector<MapObject*> &agent_arr, dou
 	return false;
 }
 
-void Agent::sprite2D(SDL_Renderer *renderer){
+void Agent::sprite2D(SDL_Renderer *renderer, Camera *cam, int zoom){
 	
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
+	int wid = cam->wid, hig = cam->hig;
 	
 	//this is done to dissuade cheating by just checking the top down view to look through walls
 	//If an agent hasn't seen the player yet, dont draw it on the screen
@@ -309,17 +302,18 @@ void Agent::sprite2D(SDL_Renderer *renderer){
 	SDL_Rect aRect;
 	//the distances are reversed since they are from the POV of the agent, whereas now we need them to be
 	//from the POV of the player
-	int screen_x = ( wid >> 1 ) + ( (int)( (-this->diffX_player) ) >> 1 );
-	int screen_y = ( hig >> 1 ) + ( (int)( (-this->diffY_player) ) >> 1 );
-	aRect.x = screen_x - ( this->objDim >> 2 );
-	aRect.y = screen_y - ( this->objDim >> 2 );
-	aRect.w = this->objDim >> 1;
-	aRect.h = this->objDim >> 1;
-	
-	int bounds_xl = (wid >> 1) - 512;
-	int bounds_xh = (wid >> 1) + 512;
-	int bounds_yl = (hig >> 1) - 512;
-	int bounds_yh = (hig >> 1) + 512;
+	int screen_x = ( wid >> 1 ) + ( (int)( (-this->diffX_player) ) >> ( 1 + zoom ) );
+	int screen_y = ( hig >> 1 ) + ( (int)( (-this->diffY_player) ) >> ( 1 + zoom ) );
+	aRect.x = screen_x - ( this->objDim >> ( 2 + zoom ) );
+	aRect.y = screen_y - ( this->objDim >> ( 2 + zoom ) );
+	aRect.w = this->objDim >> ( 1 + zoom );
+	aRect.h = this->objDim >> ( 1 + zoom );
+	
+	//the map covers the whole screen
+	int bounds_xl = 0;
+	int bounds_xh = wid;
+	int bounds_yl = 0;
+	int bounds_yh = hig;
 	
 	//if rectangle out of bounds, dont draw
 	if( aRect.x + aRect.w < bounds_xl or aRect.y + aRect.h < bounds_yl or aRect.x > bounds_xh or aRect.y > bounds_yh )
@@ -336,7 +330,7 @@ void Agent::sprite2D(SDL_Renderer *renderer){
 	
 	SDL_SetRenderDrawColor( renderer, 255, 0, 0, 255 );
 	SDL_RenderDrawLine( renderer, screen_x, screen_y,
-					screen_x + objDim*std::cos(ang), screen_y - objDim*std::sin(ang) );
+					screen_x + ( objDim >> zoom )*std::cos(ang), screen_y - ( objDim >> zoom )*std::sin(ang) );
 
 }
 
@@ -346,24 +340,24 @@ bool CompareObjects::operator()( Agent *agent1, Agent *agent2 ){
 	
 }
 
-void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player, std::vector<MapObject*> &agent_arr,
-					double spread ){
+void draw_3D_sprites( SDL_Renderer *renderer, FrameBuffer *frame, MapObject *player, std::vector<MapObject*> &agent_arr,
+					Camera *cam, const HitBuffer &hits, double maxDist ){
 	
 	//priority queue that sorts enemies acc to the distance away from the player
 	std::priority_queue< Agent*, std::vector<Agent*>, CompareObjects> dist_queue;
 	
 	for( int i = 1; i < (int)agent_arr.size(); i++ ){
-		//add it to distance based priority queue iff it's nearby
-		if( ((int)( ( (Agent*)agent_arr[i] )->diff_hypot) >> TILESHIFT) < DEPTH_OF_FIELD )
+		//add it to distance based priority queue iff it's within the draw distance
+		if( ( (Agent*)agent_arr[i] )->diff_hypot < maxDist )
 			dist_queue.push( (Agent*) agent_arr[i] );
 	}
 	
 	//now render
 	
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
+	int wid = cam->wid, hig = cam->hig;
 	
-	double screenDist = (double)wid/( 2*std::tan(spread) );
+	double spread = cam->spread;
+	double screenDist = cam->screenDist;
 	
 	while( !dist_queue.empty() ){
 		
@@ -372,14 +366,17 @@ void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player,
 		dist_queue.pop();
 	
 		//angle at which the agent lies acc. to the player, distances are flipped since POV is of player, not of agent
-		double sprite_ang = real_atan( -agent->diffX_player, agent->diffY_player );
+		bam_t sprite_ang = bam_atan2( agent->diffY_player, -agent->diffX_player );
 		
-		//The first mod2PI brings the difference back to the original modulo 2pi
-		//The second modPI brings the diff in the range (-pi, pi)
-		double ang_diff = modPI( mod2PI( sprite_ang - player->ang ) );
+		//the difference wraps around on its own, as a signed angle it lies in (-pi, pi)
+		bam_t bam_diff = sprite_ang - rad_to_bam( player->ang );
+		double ang_diff = bam_to_signed_rad( bam_diff );
 		
 		int spriteTextWid, spriteTextHig;
-		SDL_QueryTexture( agent->spriteText, NULL, NULL, &spriteTextWid, NULL );
+		if( frame != NULL )
+			spriteTextWid = agent->spriteColumns->hig;
+		else
+			SDL_QueryTexture( agent->spriteText, NULL, NULL, &spriteTextWid, NULL );
 		spriteTextHig = spriteTextWid; //ONLY SQUARE SPRITES ARE ALLOWED
 		
 		//angular size of sprite
@@ -389,20 +386,17 @@ void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player,
 		//the abs is calculated so that if part of the sprite lies inside the FOV, it is still drawn
 		if( std::fabs(ang_diff) - std::fabs(half_ang_sprite_size) < spread ){
 			
-			//NOW WE CAST THE RAYS TO DRAW THE SPRITE
-			//rays are cast so that wall clipping can be performed where sprites are being blocked by walls
+			//NOW WE DRAW THE SPRITE
+			//the wall depths castRays left behind are used to clip the sprite where walls are blocking it
 			
 			//angle at which agent is being viewed at by player + PI/8
-			double VIEW_ANGLE = mod2PI( mod2PI( mod2PI( agent->ang - player->ang ) + PI ) + 0.125*PI );
+			bam_t VIEW_ANGLE = rad_to_bam( agent->ang ) - rad_to_bam( player->ang ) + BAM_HALF + ( BAM_QUARTER >> 2 );
 			
-			//which sprite to choose based on angle
-			int SPRITE = (int)( ( VIEW_ANGLE*4 )/PI );
+			//which sprite to choose based on angle, one for every eighth of a turn
+			int SPRITE = (int)( VIEW_ANGLE >> 29 );
 			
 			//horiz position on screen at which sprite is centered
-			double pos = (wid >> 1) + std::tan( mod2PI( -ang_diff ) )*
-						( (double)(wid)/( 2*std::tan(spread) ) ); //this is the distance of screen from player (screenDist)
-			//distance away from the screen
-					//double screenDist = (double)(wid)/( 2*std::tan(spread) );
+			double pos = (wid >> 1) + bam_tan( -bam_diff )*screenDist;
 			
 			//dimensions of the sprite
 			int sprite_wid = (int)(spriteTextWid*screenDist/agent->diff_hypot);
@@ -415,30 +409,27 @@ void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player,
 			sprite_wid = sprite_wid > max_screen_dim ? max_screen_dim : sprite_wid;
 			sprite_hig = sprite_hig > max_screen_dim ? max_screen_dim : sprite_hig;
 			
-			//angle at which the sprite starts displaying
-			double start_ang = mod2PI( sprite_ang + half_ang_sprite_size );
+			//screen column of the left edge of the sprite
+			int left = (int)pos - (sprite_wid >> 1);
 			
-			//steps at which rays are casted to check if the sprite is to be clipped by a wall
-			double ang_step = (2.0*half_ang_sprite_size)/(double)sprite_wid;
+			//only the slices that land on the screen are looked at
+			int first = left < 0 ? -left : 0;
+			int last = left + sprite_wid > wid ? wid - left : sprite_wid;
 			
-			for( int i = 0; i < sprite_wid; i++ ){
-				
-				//only placeholders
-				int mapX, mapY, off;
-				
-				//angle at which ray is casted, modulo 2pi
-				double rAng = mod2PI(start_ang - i*ang_step);
+			for( int i = first; i < last; i++ ){
 				
-				double vDist, hDist, finalDist;
-				
-				cast_horiz_ray( gMap, player->x, player->y, rAng, DEPTH_OF_FIELD, &mapX, &mapY, &hDist, &off);
-				cast_vert_ray( gMap, player->x, player->y, rAng, DEPTH_OF_FIELD, &mapX, &mapY, &vDist, &off);
-				
-				//just like normal ray casting
-				finalDist = vDist > hDist ? hDist : vDist;
+				int col = left + i;
 				
 				//draw a slice of the sprite IFF A WALL IS NOT BLOCKING the sprite at this slice
-				if( finalDist > agent->diff_hypot ){
+				//both depths are fish eye corrected, just like the walls
+				if( hits.dist[col] > agent->diff_hypot*cam->colCos[col] ){
+					
+					if( frame != NULL ){
+						frame->draw_column( col, (hig - sprite_hig) >> 1, sprite_hig, agent->spriteColumns,
+											(int)((double)(spriteTextWid*i)/(double)sprite_wid), SPRITE*spriteTextWid,
+											spriteTextHig, 255 );
+						continue;
+					}
 					
 					SDL_Rect srcRect;
 					srcRect.x = (int)((double)(spriteTextWid*i)/(double)sprite_wid);
@@ -447,8 +438,7 @@ void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player,
 					srcRect.h = spriteTextHig;
 					
 					SDL_Rect dstRect;
-					dstRect.x = (int)pos - (sprite_wid >> 1) + i;
-					//dstRect.x = (wid >> 1) + std::tan( mod2PI( player->ang - rAng ) )*screenDist;
+					dstRect.x = col;
 					dstRect.y = (hig - sprite_hig) >> 1;
 					dstRect.h = sprite_hig;
 					dstRect.w = 1;
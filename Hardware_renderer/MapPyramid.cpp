@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <algorithm>
+#include <utility>
+
+//Refer to this header file for documentation
+#include <MapPyramid.h>
+#include <GameMap.h>
+
+MapPyramid::MapPyramid(){
+	pageDim = MAP_PAGE_DIM;
+	mapWid = mapHig = 0;
+	for( int k = 0; k < MAP_LEVELS; k++ )
+		pagesX[k] = 0;
+}
+
+MapPyramid::~MapPyramid(){
+	release();
+}
+
+bool MapPyramid::create( SDL_Renderer *renderer, int mapWid_, int mapHig_ ){
+
+	if( !SDL_RenderTargetSupported( renderer ) ){
+		printf( "Renderer can't draw into textures, the top down view is drawn block by block\n" );
+		return false;
+	}
+	
+	release();
+	mapWid = mapWid_; mapHig = mapHig_;
+	
+	//pages have to fit in a texture, and hold whole blocks at every level
+	SDL_RendererInfo info;
+	pageDim = MAP_PAGE_DIM;
+	if( SDL_GetRendererInfo( renderer, &info ) == 0 ){
+		while( info.max_texture_width > 0 && pageDim > info.max_texture_width )
+			pageDim >>= 1;
+		while( info.max_texture_height > 0 && pageDim > info.max_texture_height )
+			pageDim >>= 1;
+	}
+	if( pageDim < MAP_BLOCK_PIXELS )
+		pageDim = MAP_BLOCK_PIXELS;
+	
+	for( int k = 0; k < MAP_LEVELS; k++ ){
+		int pageBlocks = pageDim/( MAP_BLOCK_PIXELS >> k );
+		pagesX[k] = ( mapWid + pageBlocks - 1 )/pageBlocks;
+		int pagesY = ( mapHig + pageBlocks - 1 )/pageBlocks;
+		pages[k].assign( pagesX[k]*pagesY, NULL );
+	}
+	
+	return true;
+}
+
+void MapPyramid::release(){
+	for( int k = 0; k < MAP_LEVELS; k++ ){
+		for( int i = 0; i < (int)pages[k].size(); i++ ){
+			if( pages[k][i] != NULL )
+				SDL_DestroyTexture( pages[k][i] );
+			pages[k][i] = NULL;
+		}
+	}
+}
+
+SDL_Texture *MapPyramid::page_at( SDL_Renderer *renderer, int level, int x, int y ){
+
+	int blockDim = MAP_BLOCK_PIXELS >> level;
+	int pageBlocks = pageDim/blockDim;
+	int px = x/pageBlocks, py = y/pageBlocks;
+	
+	SDL_Texture *&page = pages[level][py*pagesX[level] + px];
+	if( page != NULL )
+		return page;
+	
+	//pages on the right and bottom edges only reach to the end of the map
+	int wid = std::min( pageDim, ( mapWid - px*pageBlocks )*blockDim );
+	int hig = std::min( pageDim, ( mapHig - py*pageBlocks )*blockDim );
+	
+	page = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, wid, hig );
+	
+	if( page == NULL ){
+		printf( "Map page couldnt be created. SDL error: %s\n", SDL_GetError() );
+		return NULL;
+	}
+	
+	//the unseen blocks are black, like the background of the top down view
+	SDL_SetTextureBlendMode( page, SDL_BLENDMODE_NONE );
+	SDL_SetRenderTarget( renderer, page );
+	SDL_SetRenderDrawColor( renderer, 0, 0, 0, 255 );
+	SDL_RenderClear( renderer );
+	
+	return page;
+}
+
+void MapPyramid::update( SDL_Renderer *renderer, GameMap *gmap, const std::vector<int> &cells ){
+
+	if( cells.empty() )
+		return;
+	
+	//cells in the order of the level 0 pages they're on, so the render target changes as little as it can
+	//the pages of the other levels are made of whole level 0 pages, so they come in runs too
+	int pageBlocks = pageDim/MAP_BLOCK_PIXELS;
+	std::vector< std::pair<int, int> > order( cells.size() );
+	for( int i = 0; i < (int)cells.size(); i++ ){
+		int x = cells[i] % mapWid, y = cells[i]/mapWid;
+		order[i] = std::make_pair( ( y/pageBlocks )*pagesX[0] + x/pageBlocks, cells[i] );
+	}
+	std::sort( order.begin(), order.end() );
+	
+	SDL_Texture *target = NULL;
+	
+	for( int k = 0; k < MAP_LEVELS; k++ ){
+		
+		int blockDim = MAP_BLOCK_PIXELS >> k;
+		int levelPageBlocks = pageDim/blockDim;
+		
+		for( int i = 0; i < (int)order.size(); i++ ){
+			
+			int x = order[i].second % mapWid, y = order[i].second/mapWid;
+			
+			SDL_Texture *page = page_at( renderer, k, x, y );
+			if( page == NULL )
+				continue;
+			if( page != target )
+				SDL_SetRenderTarget( renderer, page );
+			target = page;
+			
+			SDL_Rect blockRect;
+			blockRect.x = ( x % levelPageBlocks )*blockDim;
+			blockRect.y = ( y % levelPageBlocks )*blockDim;
+			blockRect.w = blockRect.h = blockDim;
+			
+			//the block will handle the drawing
+			gmap->block_at( y, x )->blit_wall_to_2d_screen( renderer, &blockRect );
+		}
+	}
+	
+	SDL_SetRenderTarget( renderer, NULL );
+}
+
+void MapPyramid::draw( SDL_Renderer *renderer, int level, int viewX, int viewY, int wid, int hig ){
+
+	int blockDim = MAP_BLOCK_PIXELS >> level;
+	int levelWid = mapWid*blockDim, levelHig = mapHig*blockDim;
+	
+	if( viewX + wid <= 0 || viewY + hig <= 0 || viewX >= levelWid || viewY >= levelHig )
+		return;
+	
+	//the pages under the screen, clipped to the level
+	int px0 = std::max( viewX, 0 )/pageDim, px1 = ( std::min( viewX + wid, levelWid ) - 1 )/pageDim;
+	int py0 = std::max( viewY, 0 )/pageDim, py1 = ( std::min( viewY + hig, levelHig ) - 1 )/pageDim;
+	
+	for( int py = py0; py <= py1; py++ ){
+		for( int px = px0; px <= px1; px++ ){
+			
+			SDL_Texture *page = pages[level][py*pagesX[level] + px];
+			if( page == NULL )
+				continue;
+			
+			//the part of the page on the screen, in level pixels
+			int x0 = std::max( viewX, px*pageDim ), x1 = std::min( { viewX + wid, ( px + 1 )*pageDim, levelWid } );
+			int y0 = std::max( viewY, py*pageDim ), y1 = std::min( { viewY + hig, ( py + 1 )*pageDim, levelHig } );
+			
+			SDL_Rect srcRect, dstRect;
+			srcRect.x = x0 - px*pageDim; srcRect.y = y0 - py*pageDim;
+			srcRect.w = dstRect.w = x1 - x0;
+			srcRect.h = dstRect.h = y1 - y0;
+			dstRect.x = x0 - viewX; dstRect.y = y0 - viewY;
+			
+			SDL_RenderCopy( renderer, page, &srcRect, &dstRect );
+		}
+	}
+}
@@ -0,0 +1,107 @@
+//Refer to this header file for documentation
+#include <RayPool.h>
+
+RayPool::RayPool( int thread_cnt ){
+	
+	if( thread_cnt <= 0 )
+		thread_cnt = (int)std::thread::hardware_concurrency();
+	
+	job = NULL;
+	jobCount = 0;
+	generation = 0;
+	pending = 0;
+	quit = false;
+	
+	//the calling thread takes the first strip, so one thread less is spawned
+	for( int i = 1; i < thread_cnt; i++ )
+		workers.push_back( std::thread( &RayPool::worker_loop, this, i ) );
+}
+
+RayPool::~RayPool(){
+	
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	
+	for( int i = 0; i < (int)workers.size(); i++ )
+		workers[i].join();
+}
+
+int RayPool::thread_count(){
+	return (int)workers.size() + 1;
+}
+
+void RayPool::strip_bounds( int index, int *start, int *end ){
+	
+	int threads = thread_count();
+	
+	//strips are as even as possible, the first few get one extra column
+	int base = jobCount / threads;
+	int extra = jobCount % threads;
+	
+	*start = index*base + ( index < extra ? index : extra );
+	*end = *start + base + ( index < extra ? 1 : 0 );
+}
+
+void RayPool::worker_loop( int index ){
+	
+	unsigned seen_generation = 0;
+	
+	while( true ){
+		
+		int start, end;
+		const std::function<void(int, int)> *current;
+		
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait( guard, [&]{ return quit || generation != seen_generation; } );
+			
+			if( quit )
+				return;
+			
+			seen_generation = generation;
+			current = job;
+			strip_bounds( index, &start, &end );
+		}
+		
+		if( start < end )
+			(*current)( start, end );
+		
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			pending--;
+		}
+		done.notify_one();
+	}
+}
+
+void RayPool::run( int count, const std::function<void(int, int)> &job_ ){
+	
+	//single thread fallback, no synchronization needed at all
+	if( workers.empty() ){
+		job_( 0, count );
+		return;
+	}
+	
+	int start, end;
+	
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		job = &job_;
+		jobCount = count;
+		pending = (int)workers.size();
+		generation++;
+		strip_bounds( 0, &start, &end );
+	}
+	wake.notify_all();
+	
+	//the calling thread does its share too
+	if( start < end )
+		job_( start, end );
+	
+	std::unique_lock<std::mutex> guard(lock);
+	done.wait( guard, [&]{ return pending == 0; } );
+	job = NULL;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+
+//Refer to this header file for documentation
+#include <WallBatch.h>
+
+//width of the white strip, more than one texel so that filtering never reaches into a texture
+const int WHITE_STRIP = 4;
+
+//the middle of the white strip, plain colored walls are tinted from it by the vertex color
+static inline float white_u( int atlasWid ){
+	return (float)( atlasWid - WHITE_STRIP ) + 0.5f*WHITE_STRIP;
+}
+
+WallBatch::WallBatch(){
+	atlas = NULL;
+	atlasWid = atlasHig = 0;
+	darkShade = 255;
+	lastQuads = 0;
+}
+
+WallBatch::~WallBatch(){
+	if( atlas != NULL )
+		SDL_DestroyTexture( atlas );
+}
+
+bool WallBatch::load_atlas( SDL_Renderer *renderer, const PixelImage *wall_pixels, double wallColorRatio ){
+	
+	atlasWid = wall_pixels->wid + WHITE_STRIP;
+	atlasHig = wall_pixels->hig;
+	
+	//the wall textures with the white strip on their right
+	std::vector<Uint32> pixels( atlasWid*atlasHig, 0xFFFFFFFFu );
+	for( int i = 0; i < atlasHig; i++ )
+		for( int j = 0; j < wall_pixels->wid; j++ )
+			pixels[i*atlasWid + j] = wall_pixels->pixels[i*wall_pixels->wid + j];
+	
+	atlas = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, atlasWid, atlasHig );
+	
+	if( atlas == NULL ){
+		printf( "Wall atlas couldnt be created. SDL error: %s\n", SDL_GetError() );
+		return false;
+	}
+	
+	SDL_UpdateTexture( atlas, NULL, pixels.data(), atlasWid*sizeof(Uint32) );
+	
+	//for fading out walls near the draw distance
+	SDL_SetTextureBlendMode( atlas, SDL_BLENDMODE_BLEND );
+	
+	darkShade = (Uint8)( 255.0*wallColorRatio );
+	
+	return true;
+}
+
+void WallBatch::clear(){
+	vertices.clear();
+	indices.clear();
+}
+
+void WallBatch::add_trapezoid( const WallSpan *span, float u0, float v0, float u1, float v1, SDL_Color color ){
+	
+	int first = (int)vertices.size();
+	
+	//top left, top right, bottom right, bottom left, texture coords are normalized
+	SDL_Vertex corner;
+	corner.color = color;
+	
+	corner.position.x = span->x0; corner.position.y = span->top0;
+	corner.tex_coord.x = u0/atlasWid; corner.tex_coord.y = v0/atlasHig;
+	vertices.push_back( corner );
+	corner.position.x = span->x1; corner.position.y = span->top1;
+	corner.tex_coord.x = u1/atlasWid;
+	vertices.push_back( corner );
+	corner.position.y = span->bottom1;
+	corner.tex_coord.y = v1/atlasHig;
+	vertices.push_back( corner );
+	corner.position.x = span->x0; corner.position.y = span->bottom0;
+	corner.tex_coord.x = u0/atlasWid;
+	vertices.push_back( corner );
+	
+	//two triangles
+	indices.push_back( first ); indices.push_back( first + 1 ); indices.push_back( first + 2 );
+	indices.push_back( first ); indices.push_back( first + 2 ); indices.push_back( first + 3 );
+}
+
+//a single column is a trapezoid with straight sides
+static void column_span( SDL_Rect *dstRect, WallSpan *span ){
+	span->x0 = (float)dstRect->x; span->x1 = (float)( dstRect->x + dstRect->w );
+	span->top0 = span->top1 = (float)dstRect->y;
+	span->bottom0 = span->bottom1 = (float)( dstRect->y + dstRect->h );
+}
+
+void WallBatch::add_textured_column( SDL_Rect *dstRect, int srcX, int srcY, int srcH, bool dark, Uint8 alpha ){
+	
+	//the dark side is the same texture, tinted by the vertex color
+	Uint8 shade = dark ? darkShade : 255;
+	SDL_Color color = { shade, shade, shade, alpha };
+	
+	WallSpan span;
+	column_span( dstRect, &span );
+	add_trapezoid( &span, (float)srcX, (float)srcY, (float)( srcX + 1 ), (float)( srcY + srcH ), color );
+}
+
+void WallBatch::add_color_column( SDL_Rect *dstRect, Uint8 r, Uint8 g, Uint8 b, Uint8 alpha ){
+	
+	SDL_Color color = { r, g, b, alpha };
+	
+	WallSpan span;
+	column_span( dstRect, &span );
+	add_trapezoid( &span, white_u( atlasWid ), 0.5f*atlasHig, white_u( atlasWid ), 0.5f*atlasHig, color );
+}
+
+void WallBatch::add_textured_span( const WallSpan *span, int srcX, bool dark, Uint8 alpha ){
+	
+	Uint8 shade = dark ? darkShade : 255;
+	SDL_Color color = { shade, shade, shade, alpha };
+	
+	//the whole height of the texture, the renderer clips whatever lies off screen
+	add_trapezoid( span, (float)srcX + span->u0, 0.0f, (float)srcX + span->u1, (float)atlasHig, color );
+}
+
+void WallBatch::add_color_span( const WallSpan *span, Uint8 r, Uint8 g, Uint8 b, Uint8 alpha ){
+	
+	SDL_Color color = { r, g, b, alpha };
+	
+	add_trapezoid( span, white_u( atlasWid ), 0.5f*atlasHig, white_u( atlasWid ), 0.5f*atlasHig, color );
+}
+
+void WallBatch::flush( SDL_Renderer *renderer ){
+	
+	lastQuads = (int)indices.size()/6;
+	
+	if( !indices.empty() )
+		SDL_RenderGeometry( renderer, atlas, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size() );
+	
+	clear();
+}
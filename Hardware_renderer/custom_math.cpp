@@ -1,23 +1,19 @@
 #include <custom_math.h>
+#include <algorithm>
+
+//the packet caster is only built where AVX2 intrinsics can be used
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define RAY_PACKET_AVX2
+#include <immintrin.h>
+#endif
 
 #define PI 3.1415926535897932384
 const unsigned BLOCK_DIM = 64;
 const unsigned TILESHIFT = 6;
 
-//returns actual angle for given base and height of triangle
+//returns actual angle for given base and height of triangle, in [0, 2pi)
 double real_atan(double diffX, double diffY){
-	double sprite_ang = std::atan( diffY / diffX );
-	if( sprite_ang > 0 ){
-		if( diffY < 0 && diffX < 0 )
-			sprite_ang += PI;	//3rd quadrant
-	}else{
-		if( diffY > 0 && diffX < 0 )
-			sprite_ang += PI;	//2nd quadrant
-		else //if( diffY < 0 && diffX > 0 )
-			sprite_ang += 2*PI;	//4th quadrant
-	}
-	//unchanged if 1st quadrant
-	return sprite_ang;
+	return bam_to_rad( bam_atan2( diffY, diffX ) );
 }
 
 //assumes angle is a sum/difference of two modulo 2pi numbers
@@ -146,4 +142,505 @@ bool cast_vert_ray( GameMap *gMap, double posX, double posY, double rAng, int de
 	*dist = std::hypot(posX - rayX, posY - rayY);
 	
 	return dof == depth;
-}
\ No newline at end of file
+}
+
+//state of a ray walking through the grid, shared by the single ray and packet casters
+struct RayWalk{
+	double dirX, dirY;
+	int cellX, cellY;
+	int stepX, stepY;
+	double deltaX, deltaY;
+	double distX, distY;
+};
+
+static void start_walk( double posX, double posY, bam_t rAng, RayWalk *w ){
+	
+	//direction of the ray, y is flipped since the map grows downwards
+	w->dirX = bam_cos(rAng);
+	w->dirY = -bam_sin(rAng);
+	
+	//the block in which the ray starts
+	w->cellX = (int)posX >> TILESHIFT;
+	w->cellY = (int)posY >> TILESHIFT;
+	
+	//which way the ray walks through the grid
+	w->stepX = w->dirX > 0 ? 1 : -1;
+	w->stepY = w->dirY > 0 ? 1 : -1;
+	
+	//ray distance needed to cross one full block in x and in y
+	w->deltaX = w->dirX != 0.0 ? (double)BLOCK_DIM/std::fabs(w->dirX) : HUGE_VAL;
+	w->deltaY = w->dirY != 0.0 ? (double)BLOCK_DIM/std::fabs(w->dirY) : HUGE_VAL;
+	
+	//ray distance to the first vert and horiz grid line
+	w->distX = w->distY = HUGE_VAL;
+	if( w->dirX > 0 )
+		w->distX = ( (double)( ( w->cellX << TILESHIFT ) + BLOCK_DIM ) - posX )/w->dirX;
+	else if( w->dirX < 0 )
+		w->distX = ( posX - (double)( w->cellX << TILESHIFT ) )/-w->dirX;
+	if( w->dirY > 0 )
+		w->distY = ( (double)( ( w->cellY << TILESHIFT ) + BLOCK_DIM ) - posY )/w->dirY;
+	else if( w->dirY < 0 )
+		w->distY = ( posY - (double)( w->cellY << TILESHIFT ) )/-w->dirY;
+}
+
+//for showing textured walls, same offsets as the legacy casters
+static void finish_walk( double posX, double posY, RayWalk *w, RayHit *hit ){
+	if( hit->isVertical ){
+		double rayY = posY + w->dirY*hit->dist;
+		hit->offset = (int) (rayY - (double)( ( (int)rayY >> TILESHIFT ) << TILESHIFT ));
+	}else{
+		double rayX = posX + w->dirX*hit->dist;
+		hit->offset = (int) (rayX - (double)( ( (int)rayX >> TILESHIFT ) << TILESHIFT ));
+	}
+}
+
+//number of grid lines (at most max_cnt) that a ray crosses before travelling exitDist
+static inline int crossings_before( double dist, double delta, double exitDist, int max_cnt ){
+	if( dist >= exitDist )
+		return 0;
+	int cnt = (int)std::ceil( ( exitDist - dist )/delta );
+	return cnt < max_cnt ? cnt : max_cnt;
+}
+
+//the grid walk behind cast_ray and cast_ray_skip
+//with SKIP, empty space around the ray is jumped over using the map's distance field
+template<bool SKIP>
+static void walk_ray( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit ){
+	
+	RayWalk w;
+	start_walk( posX, posY, rAng, &w );
+	
+	hit->hit = false;
+	hit->dist = 0.0;
+	hit->mapX = w.cellX; hit->mapY = w.cellY;
+	hit->isVertical = false;
+	
+	while( true ){
+		
+		if( SKIP ){
+			//every block less than this many blocks away from the current one is empty
+			int free = gMap->free_dist( w.cellY, w.cellX ) - 1;
+			
+			if( free > 0 ){
+				//the ray leaves the empty square at the first grid line on its edge
+				double exitX = w.distX + free*w.deltaX;
+				double exitY = w.distY + free*w.deltaY;
+				double exitDist = exitX < exitY ? exitX : exitY;
+				
+				//jump over all the lines inside the square at once
+				int nX = crossings_before( w.distX, w.deltaX, exitDist, free );
+				int nY = crossings_before( w.distY, w.deltaY, exitDist, free );
+				
+				//a ray parallel to an axis has an infinite delta on it, which must not be multiplied by 0
+				if( nX > 0 ){
+					w.cellX += nX*w.stepX;
+					w.distX += nX*w.deltaX;
+				}
+				if( nY > 0 ){
+					w.cellY += nY*w.stepY;
+					w.distY += nY*w.deltaY;
+				}
+			}
+		}
+		
+		//take whichever grid line comes first along the ray
+		bool vertical = w.distX < w.distY;
+		
+		if( vertical ){
+			//a vert line lies on the right edge of the block if looking right
+			hit->mapX = w.stepX > 0 ? w.cellX + 1 : w.cellX;
+			hit->mapY = w.cellY;
+			hit->dist = w.distX;
+		}else{
+			//a horiz line lies on the bottom edge of the block if looking down
+			hit->mapX = w.cellX;
+			hit->mapY = w.stepY > 0 ? w.cellY + 1 : w.cellY;
+			hit->dist = w.distY;
+		}
+		hit->isVertical = vertical;
+		
+		//the draw distance ran out before a wall was found
+		if( hit->dist > maxDist )
+			break;
+		
+		//the map is walled in by solid bits, so no bounds checks are needed
+		if( vertical ? gMap->solid_vert_wall_bit( hit->mapY, hit->mapX )
+					: gMap->solid_horiz_wall_bit( hit->mapY, hit->mapX ) ){
+			hit->hit = true;
+			break;
+		}
+		
+		//if not, keep going
+		if( vertical ){
+			w.cellX += w.stepX;
+			w.distX += w.deltaX;
+		}else{
+			w.cellY += w.stepY;
+			w.distY += w.deltaY;
+		}
+	}
+	
+	finish_walk( posX, posY, &w, hit );
+}
+
+void cast_ray( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit ){
+	walk_ray<false>( gMap, posX, posY, rAng, maxDist, hit );
+}
+
+void cast_ray_skip( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit ){
+	walk_ray<true>( gMap, posX, posY, rAng, maxDist, hit );
+}
+
+//fractional bits of the fixed point coordinates
+const int FIXED_SHIFT = 16;
+//shift from fixed point map units to blocks
+const int FIXED_TILESHIFT = FIXED_SHIFT + TILESHIFT;
+//fixed point values are clamped to this (256 blocks), outside any map that is walked in fixed point,
+//so adding a step to an intercept inside the map never overflows
+const double FIXED_CLAMP = (double)( ( 1 << 30 ) - 1 );
+
+static inline Sint32 to_fixed( double v ){
+	v *= (double)( 1 << FIXED_SHIFT );
+	if( v > FIXED_CLAMP )
+		v = FIXED_CLAMP;
+	else if( v < -FIXED_CLAMP )
+		v = -FIXED_CLAMP;
+	return (Sint32)std::floor( v + 0.5 );
+}
+
+void cast_ray_fixed( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit ){
+	
+	if( gMap->map_width() > FIXED_MAX_BLOCKS || gMap->map_height() > FIXED_MAX_BLOCKS ){
+		cast_ray( gMap, posX, posY, rAng, maxDist, hit );
+		return;
+	}
+	
+	//direction of the ray, y is flipped since the map grows downwards
+	double dirX = bam_cos(rAng);
+	double dirY = -bam_sin(rAng);
+	
+	int stepX = dirX > 0 ? 1 : -1;
+	int stepY = dirY > 0 ? 1 : -1;
+	
+	int cellX = (int)posX >> TILESHIFT;
+	int cellY = (int)posY >> TILESHIFT;
+	
+	//the next vert and horiz grid line the ray crosses, as line indices
+	int lineX = stepX > 0 ? cellX + 1 : cellX;
+	int lineY = stepY > 0 ? cellY + 1 : cellY;
+	
+	//where the ray crosses those lines: the y of the vert line crossing and the x of the horiz one,
+	//and how much they move from one line to the next. A ray parallel to an axis never crosses
+	//the lines along it, its intercept is pushed out of reach
+	Sint32 yIntercept, xIntercept, yStep, xStep;
+	if( dirX != 0.0 ){
+		yIntercept = to_fixed( posY + ( (double)( lineX << TILESHIFT ) - posX )*dirY/dirX );
+		yStep = to_fixed( (double)BLOCK_DIM*dirY/std::fabs(dirX) );
+	}else{
+		yIntercept = to_fixed( stepY*HUGE_VAL );
+		yStep = 0;
+	}
+	if( dirY != 0.0 ){
+		xIntercept = to_fixed( posX + ( (double)( lineY << TILESHIFT ) - posY )*dirX/dirY );
+		xStep = to_fixed( (double)BLOCK_DIM*dirX/std::fabs(dirY) );
+	}else{
+		xIntercept = to_fixed( stepX*HUGE_VAL );
+		xStep = 0;
+	}
+	
+	//the draw distance as the farthest x and y the ray reaches. It's capped at the map's diagonal, which
+	//no ray inside the map gets past, so an unbounded one doesn't multiply a zero direction by infinity
+	double reach = std::min( maxDist, std::hypot( (double)gMap->map_width(), (double)gMap->map_height() )*BLOCK_DIM );
+	Sint32 endX = to_fixed( posX + dirX*reach );
+	Sint32 endY = to_fixed( posY + dirY*reach );
+	
+	hit->hit = false;
+	
+	while( true ){
+		
+		//the vert line comes first if the ray crosses it before reaching the next horiz line
+		//a ray parallel to an axis only ever crosses the other lines, even when it runs along a grid line,
+		//where its pushed out intercept would compare equal to the line
+		Sint32 hLine = lineY << FIXED_TILESHIFT;
+		bool vertical;
+		if( dirY == 0.0 )
+			vertical = true;
+		else if( dirX == 0.0 )
+			vertical = false;
+		else
+			vertical = stepY > 0 ? yIntercept < hLine : yIntercept > hLine;
+		
+		Sint32 line;
+		if( vertical ){
+			hit->mapX = lineX;
+			hit->mapY = yIntercept >> FIXED_TILESHIFT;
+			line = lineX << FIXED_TILESHIFT;
+		}else{
+			hit->mapX = xIntercept >> FIXED_TILESHIFT;
+			hit->mapY = lineY;
+			line = hLine;
+		}
+		hit->isVertical = vertical;
+		
+		//the draw distance ran out before a wall was found
+		if( vertical ? ( stepX > 0 ? line > endX : line < endX )
+					: ( stepY > 0 ? line > endY : line < endY ) )
+			break;
+		
+		//the map is walled in by solid bits, so no bounds checks are needed
+		if( vertical ? gMap->solid_vert_wall_bit( hit->mapY, hit->mapX )
+					: gMap->solid_horiz_wall_bit( hit->mapY, hit->mapX ) ){
+			hit->hit = true;
+			break;
+		}
+		
+		//if not, keep going
+		if( vertical ){
+			lineX += stepX;
+			yIntercept += yStep;
+		}else{
+			lineY += stepY;
+			xIntercept += xStep;
+		}
+	}
+	
+	//the offset into the texture is the position along the wall line, inside the block
+	if( hit->isVertical ){
+		hit->offset = ( yIntercept >> FIXED_SHIFT ) & ( BLOCK_DIM - 1 );
+		hit->dist = ( (double)( lineX << TILESHIFT ) - posX )/dirX;
+	}else{
+		hit->offset = ( xIntercept >> FIXED_SHIFT ) & ( BLOCK_DIM - 1 );
+		hit->dist = ( (double)( lineY << TILESHIFT ) - posY )/dirY;
+	}
+}
+
+//scalar fallback for the packet caster, one ray after the other
+static void cast_ray_packet_scalar( GameMap *gMap, double posX, double posY, const bam_t *rAng,
+								int count, double maxDist, RayHit *hits ){
+	for( int i = 0; i < count; i++ )
+		cast_ray( gMap, posX, posY, rAng[i], maxDist, &hits[i] );
+}
+
+#ifdef RAY_PACKET_AVX2
+
+//AVX2 packet caster, all rays of the packet step through the grid together
+//lanes hold doubles so every ray ends up exactly where the scalar caster would
+__attribute__((target("avx2")))
+static void cast_ray_packet_avx2( GameMap *gMap, double posX, double posY, const bam_t *rAng,
+								int count, double maxDist, RayHit *hits ){
+	
+	alignas(32) double cellX[RAY_PACKET], cellY[RAY_PACKET], stepX[RAY_PACKET], stepY[RAY_PACKET];
+	alignas(32) double deltaX[RAY_PACKET], deltaY[RAY_PACKET], distX[RAY_PACKET], distY[RAY_PACKET];
+	
+	RayWalk walks[RAY_PACKET];
+	
+	//setting up every lane exactly like the scalar caster
+	for( int i = 0; i < RAY_PACKET; i++ ){
+		
+		RayWalk &w = walks[i];
+		start_walk( posX, posY, i < count ? rAng[i] : 0, &w );
+		
+		cellX[i] = w.cellX; cellY[i] = w.cellY;
+		stepX[i] = w.stepX; stepY[i] = w.stepY;
+		deltaX[i] = w.deltaX; deltaY[i] = w.deltaY;
+		distX[i] = w.distX; distY[i] = w.distY;
+		
+		if( i < count ){
+			hits[i].hit = false;
+			hits[i].dist = 0.0;
+			hits[i].mapX = w.cellX; hits[i].mapY = w.cellY;
+			hits[i].isVertical = false;
+		}
+	}
+	
+	__m256d vCellX = _mm256_load_pd(cellX), vCellY = _mm256_load_pd(cellY);
+	__m256d vStepX = _mm256_load_pd(stepX), vStepY = _mm256_load_pd(stepY);
+	__m256d vDeltaX = _mm256_load_pd(deltaX), vDeltaY = _mm256_load_pd(deltaY);
+	__m256d vDistX = _mm256_load_pd(distX), vDistY = _mm256_load_pd(distY);
+	
+	const __m256d vMaxDist = _mm256_set1_pd( maxDist );
+	const __m256d vOne = _mm256_set1_pd( 1.0 );
+	const __m256d vZero = _mm256_setzero_pd();
+	
+	//lanes that are still walking
+	__m256d active = _mm256_castsi256_pd( _mm256_set_epi64x( count > 3 ? -1 : 0, count > 2 ? -1 : 0,
+															count > 1 ? -1 : 0, count > 0 ? -1 : 0 ) );
+	
+	alignas(32) double lineX[RAY_PACKET], lineY[RAY_PACKET], lineDist[RAY_PACKET], vert[RAY_PACKET];
+	
+	while( _mm256_movemask_pd( active ) != 0 ){
+		
+		//take whichever grid line comes first along the ray
+		__m256d vertical = _mm256_cmp_pd( vDistX, vDistY, _CMP_LT_OQ );
+		
+		//a vert line lies on the right edge of the block if looking right,
+		//a horiz line on the bottom edge if looking down
+		__m256d nextX = _mm256_add_pd( vCellX, _mm256_and_pd( _mm256_cmp_pd( vStepX, vZero, _CMP_GT_OQ ), vOne ) );
+		__m256d nextY = _mm256_add_pd( vCellY, _mm256_and_pd( _mm256_cmp_pd( vStepY, vZero, _CMP_GT_OQ ), vOne ) );
+		
+		__m256d vLineDist = _mm256_blendv_pd( vDistY, vDistX, vertical );
+		
+		//lanes whose draw distance ran out stop without a hit
+		__m256d spent = _mm256_cmp_pd( vLineDist, vMaxDist, _CMP_GT_OQ );
+		
+		_mm256_store_pd( lineX, _mm256_blendv_pd( vCellX, nextX, vertical ) );
+		_mm256_store_pd( lineY, _mm256_blendv_pd( nextY, vCellY, vertical ) );
+		_mm256_store_pd( lineDist, vLineDist );
+		_mm256_store_pd( vert, vertical );
+		
+		//map lookups are per lane, only for the lanes still walking
+		int live = _mm256_movemask_pd( active );
+		int look = live & ~_mm256_movemask_pd( spent );
+		alignas(32) double solid[RAY_PACKET] = { 0.0, 0.0, 0.0, 0.0 };
+		
+		for( int i = 0; i < RAY_PACKET; i++ ){
+			
+			if( !( live & ( 1 << i ) ) )
+				continue;
+			
+			RayHit &hit = hits[i];
+			hit.mapX = (int)lineX[i];
+			hit.mapY = (int)lineY[i];
+			hit.dist = lineDist[i];
+			hit.isVertical = vert[i] != 0.0;
+			
+			if( !( look & ( 1 << i ) ) )
+				continue;
+			
+			hit.hit = hit.isVertical ? gMap->solid_vert_wall_bit( hit.mapY, hit.mapX )
+									: gMap->solid_horiz_wall_bit( hit.mapY, hit.mapX );
+			if( hit.hit )
+				solid[i] = 1.0;
+		}
+		
+		//lanes that found a wall or ran out stop here, the others step to the next line
+		active = _mm256_andnot_pd( _mm256_or_pd( spent, _mm256_cmp_pd( _mm256_load_pd(solid), vZero, _CMP_NEQ_OQ ) ),
+									active );
+		__m256d stepV = _mm256_and_pd( active, vertical );
+		__m256d stepH = _mm256_andnot_pd( vertical, active );
+		
+		vCellX = _mm256_add_pd( vCellX, _mm256_and_pd( stepV, vStepX ) );
+		vDistX = _mm256_blendv_pd( vDistX, _mm256_add_pd( vDistX, vDeltaX ), stepV );
+		
+		vCellY = _mm256_add_pd( vCellY, _mm256_and_pd( stepH, vStepY ) );
+		vDistY = _mm256_blendv_pd( vDistY, _mm256_add_pd( vDistY, vDeltaY ), stepH );
+	}
+	
+	for( int i = 0; i < count; i++ )
+		finish_walk( posX, posY, &walks[i], &hits[i] );
+}
+
+#endif
+
+bool packet_simd_supported(){
+#ifdef RAY_PACKET_AVX2
+	return SDL_HasAVX2() == SDL_TRUE;
+#else
+	return false;
+#endif
+}
+
+typedef void (*PacketCaster)( GameMap*, double, double, const bam_t*, int, double, RayHit* );
+
+//the packet caster for this CPU
+static PacketCaster pick_packet_caster(){
+#ifdef RAY_PACKET_AVX2
+	return packet_simd_supported() ? cast_ray_packet_avx2 : cast_ray_packet_scalar;
+#else
+	return cast_ray_packet_scalar;
+#endif
+}
+
+void cast_ray_packet( GameMap *gMap, double posX, double posY, const bam_t *rAng, int count, double maxDist,
+					TraversalMode mode, RayHit *hits ){
+	
+	//the rays of a packet would split up as soon as they skip by different amounts
+	//so skipping is always done one ray at a time
+	if( mode == TRAVERSE_SKIP ){
+		for( int i = 0; i < count; i++ )
+			cast_ray_skip( gMap, posX, posY, rAng[i], maxDist, &hits[i] );
+		return;
+	}
+	//the fixed point walk has no packet version
+	if( mode == TRAVERSE_FIXED ){
+		for( int i = 0; i < count; i++ )
+			cast_ray_fixed( gMap, posX, posY, rAng[i], maxDist, &hits[i] );
+		return;
+	}
+	
+	//picked once, by whichever worker thread casts first, the others wait until it's set
+	static const PacketCaster packet_caster = pick_packet_caster();
+	
+	packet_caster( gMap, posX, posY, rAng, count, maxDist, hits );
+}
+
+void ray_hit_on_line( double posX, double posY, bam_t rAng, RayHit *hit ){
+	
+	RayWalk w;
+	w.dirX = bam_cos(rAng);
+	w.dirY = -bam_sin(rAng);
+	
+	//intersection of the ray with the wall line
+	if( hit->isVertical )
+		hit->dist = ( (double)( hit->mapX << TILESHIFT ) - posX )/w.dirX;
+	else
+		hit->dist = ( (double)( hit->mapY << TILESHIFT ) - posY )/w.dirY;
+	
+	finish_walk( posX, posY, &w, hit );
+}
+
+void ray_hit_on_line_fixed( GameMap *gMap, double posX, double posY, bam_t rAng, RayHit *hit ){
+	
+	//cast_ray_fixed walks these in floating point too
+	if( gMap->map_width() > FIXED_MAX_BLOCKS || gMap->map_height() > FIXED_MAX_BLOCKS ){
+		ray_hit_on_line( posX, posY, rAng, hit );
+		return;
+	}
+	
+	double dirX = bam_cos(rAng);
+	double dirY = -bam_sin(rAng);
+	
+	//the intercept is set up at the first line and stepped to the wall line the way cast_ray_fixed
+	//does it, so it is rounded the same and lands on the same texel
+	Sint64 intercept;
+	if( hit->isVertical ){
+		int stepX = dirX > 0 ? 1 : -1;
+		int lineX = stepX > 0 ? ( (int)posX >> TILESHIFT ) + 1 : (int)posX >> TILESHIFT;
+		intercept = to_fixed( posY + ( (double)( lineX << TILESHIFT ) - posX )*dirY/dirX )
+					+ (Sint64)( ( hit->mapX - lineX )*stepX )*to_fixed( (double)BLOCK_DIM*dirY/std::fabs(dirX) );
+		hit->dist = ( (double)( hit->mapX << TILESHIFT ) - posX )/dirX;
+	}else{
+		int stepY = dirY > 0 ? 1 : -1;
+		int lineY = stepY > 0 ? ( (int)posY >> TILESHIFT ) + 1 : (int)posY >> TILESHIFT;
+		intercept = to_fixed( posX + ( (double)( lineY << TILESHIFT ) - posY )*dirX/dirY )
+					+ (Sint64)( ( hit->mapY - lineY )*stepY )*to_fixed( (double)BLOCK_DIM*dirX/std::fabs(dirY) );
+		hit->dist = ( (double)( hit->mapY << TILESHIFT ) - posY )/dirY;
+	}
+	
+	hit->offset = (int)( ( intercept >> FIXED_SHIFT ) & ( BLOCK_DIM - 1 ) );
+}
+
+void cast_ray_legacy( GameMap *gMap, double posX, double posY, double rAng, int depth, RayHit *hit ){
+	
+	int vmapX, vmapY, hmapX, hmapY, v_offset, h_offset;
+	double vDist, hDist;
+	
+	vmapX = vmapY = hmapX = hmapY = 0;
+	
+	bool hMiss = cast_horiz_ray( gMap, posX, posY, rAng, depth, &hmapX, &hmapY, &hDist, &h_offset );
+	bool vMiss = cast_vert_ray( gMap, posX, posY, rAng, depth, &vmapX, &vmapY, &vDist, &v_offset );
+	
+	if( vDist > hDist ){
+		hit->dist = hDist;
+		hit->mapX = hmapX; hit->mapY = hmapY;
+		hit->offset = h_offset;
+		hit->isVertical = false;
+		hit->hit = !hMiss;
+	}else{
+		hit->dist = vDist;
+		hit->mapX = vmapX; hit->mapY = vmapY;
+		hit->offset = v_offset;
+		hit->isVertical = true;
+		hit->hit = !vMiss;
+	}
+}
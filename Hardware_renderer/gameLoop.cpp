@@ -2,6 +2,8 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <set>
 #include <chrono>
 #include <vector>
@@ -11,14 +13,58 @@
 #include <MapObject.h>
 #include <custom_math.h>
 #include <helper.h>
+#include <RayPool.h>
+#include <Camera.h>
+#include <FrameBuffer.h>
+#include <ColorMap.h>
+#include <FloorCaster.h>
+#include <WallBatch.h>
+#include <MapPyramid.h>
 
 const unsigned BLOCK_DIM = 64;
 const unsigned TILESHIFT = 6;
-const int DEPTH_OF_FIELD = 20;
+
+//how far away walls are drawn, in blocks. 0 draws everything up to the edge of the map
+//can be overridden with "-drawdist N" on the command line
+const double DRAW_DISTANCE = 0.0;
+//the draw distance used when switching to a fixed one with F2
+const double FIXED_DRAW_DISTANCE = 20.0;
+//time the 3D view should take to render when the draw distance or the render scale is automatic, in seconds
+//can be overridden with "-target MS" on the command line
+const double TARGET_RENDER_TIME = 0.008;
+//fraction of the screen width around the center where every column is cast, 1 casts them all
+//can be overridden with "-fovea F" on the command line, F9 cycles between 1 and these two
+const double FOVEA_WIDTH = 1.0;
+const double FOVEA_BALANCED = 0.5;
+const double FOVEA_FAST = 0.25;
+//columns apart that rays are cast at first with edge refinement, 1 casts every column
+//can be overridden with "-refine N" on the command line, F10 switches it on and off
+const int REFINE_STEP = 8;
+//size of the 3D view relative to the window, 0 picks it automatically from the render time
+//can be overridden with "-scale S" on the command line
+const double RENDER_SCALE = 0.0;
+//fog steps of the color map, and the distance in blocks at which walls vanish into the fog
+const int LIGHT_LEVELS = 32;
+const double FOG_DISTANCE = 40.0;
+//which of the wall textures the floor and the ceiling are covered with
+const int FLOOR_TEXTURE = 3;
+const int CEILING_TEXTURE = 1;
 
 const int SCREEN_WIDTH = 1920;
 const int SCREEN_HEIGHT = 1080;
 
+//the shipped levels, and how many rays "-compare-fixed" casts on each
+const char *const LEVELS[] = { "./Images/levelTrial.bmp", "./Images/levelTrial2.bmp", "./Images/levelTrial3.bmp",
+							"./Images/levelTrial4.bmp", "./Images/levelTrial5.bmp", "./Images/spriteTest.bmp" };
+const int LEVEL_CNT = sizeof( LEVELS )/sizeof( LEVELS[0] );
+const int COMPARE_RAYS = 100000;
+//angles timed by "-bench-trig"
+const int BENCH_SAMPLES = 1 << 20;
+
+//threads used for ray casting, 0 uses every core and 1 casts on the main thread only
+//can be overridden with "-threads N" on the command line
+const int RAY_THREADS = 0;
+
 //the window on which everything is displayed
 SDL_Window *window = NULL;
 //The renderer, for hardware rendering
@@ -43,6 +89,9 @@ bool init_SDL(){
 			
 			renderer = SDL_CreateRenderer ( window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC );
 			
+			//walls fade out near the draw distance
+			SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_BLEND );
+			
 		}
 	}
 	
@@ -66,6 +115,37 @@ void close_SDL(){
 
 int main( int argc, char* args[] ){
 	
+	int ray_threads = RAY_THREADS;
+	double draw_dist = DRAW_DISTANCE;
+	double target_time = TARGET_RENDER_TIME;
+	double render_scale = RENDER_SCALE;
+	double fovea_width = FOVEA_WIDTH;
+	int refine_step = REFINE_STEP;
+	
+	//reading command line options
+	for( int i = 1; i < argc; i++ ){
+		if( std::strcmp( args[i], "-threads" ) == 0 and i + 1 < argc )
+			ray_threads = std::atoi( args[++i] );
+		else if( std::strcmp( args[i], "-drawdist" ) == 0 and i + 1 < argc )
+			draw_dist = std::atof( args[++i] );
+		else if( std::strcmp( args[i], "-target" ) == 0 and i + 1 < argc )
+			target_time = std::atof( args[++i] )*0.001;
+		else if( std::strcmp( args[i], "-scale" ) == 0 and i + 1 < argc )
+			render_scale = std::atof( args[++i] );
+		else if( std::strcmp( args[i], "-fovea" ) == 0 and i + 1 < argc )
+			fovea_width = std::atof( args[++i] );
+		else if( std::strcmp( args[i], "-refine" ) == 0 and i + 1 < argc )
+			refine_step = std::atoi( args[++i] );
+		else if( std::strcmp( args[i], "-compare-fixed" ) == 0 ){
+			//checks the fixed point traversal against the floating point one on the shipped levels
+			return compare_fixed_traversal( LEVELS, LEVEL_CNT, COMPARE_RAYS ) == 0 ? 0 : 1;
+		}else if( std::strcmp( args[i], "-bench-trig" ) == 0 ){
+			//times the trig tables against the standard library
+			bench_trig( BENCH_SAMPLES );
+			return 0;
+		}
+	}
+	
 	if( !init_SDL() )
 		return 0;
 	
@@ -80,18 +160,30 @@ int main( int argc, char* args[] ){
 		return 0;
 	}
 	
-	//the image holding the darkened versions of the wall textures
-	SDL_Surface *dark_wall_surfaces = SDL_CreateRGBSurface( 0, wall_surfaces->w, wall_surfaces->h, 24, 0, 0, 0, 0 );
+	//the software frame buffer reads the textures as plain pixels, turned on their side
+	//so that it walks down a wall column through memory that lies together,
+	//and halved again and again for far walls
+	PixelImage wall_pixels;
+	load_pixels( wall_surfaces, &wall_pixels );
+	MipChain wall_mips;
+	build_mips( &wall_pixels, &wall_mips );
+	
+	//and as palette indices, which the walls are drawn from, with the dark sides and the fog in a color map
+	ColorMap colormap;
+	IndexedMips wall_indexed;
+	colormap.index_mips( &wall_mips, &wall_indexed );
 	
-	//change the pixels in the dark texture image
-	create_dark_walls( wall_surfaces, dark_wall_surfaces, 0.75 );
+	//floors and ceilings are tiled with wall textures, one per block
+	FloorCaster floor_caster;
+	floor_caster.load_textures( &wall_pixels, &wall_indexed, FLOOR_TEXTURE, CEILING_TEXTURE );
 	
 	SDL_Texture *wall_textures = SDL_CreateTextureFromSurface( renderer, wall_surfaces );
-	SDL_Texture *dark_wall_textures = SDL_CreateTextureFromSurface( renderer, dark_wall_surfaces );
+	
+	//for fading out walls near the draw distance
+	SDL_SetTextureBlendMode( wall_textures, SDL_BLENDMODE_BLEND );
 	
 	SDL_FreeSurface( wall_surfaces );
-	SDL_FreeSurface( dark_wall_surfaces );
-	wall_surfaces = dark_wall_surfaces = NULL;
+	wall_surfaces = NULL;
 	
 	
 	//this is the map image that is used to load the map
@@ -101,7 +193,6 @@ int main( int argc, char* args[] ){
 	if( mapImg == NULL ){
 		std::printf( "Map image couldnt be loaded. Error: %s\n", SDL_GetError() );
 		SDL_DestroyTexture( wall_textures );
-		SDL_DestroyTexture( dark_wall_textures );
 		close_SDL();
 		return 0;
 	}
@@ -113,12 +204,33 @@ int main( int argc, char* args[] ){
 	if( spriteText == NULL or fast_spriteText == NULL ){
 		std::printf( "Sprite not initialized. Error: %s\n", SDL_GetError() );
 		SDL_DestroyTexture( wall_textures );
-		SDL_DestroyTexture( dark_wall_textures );
 		SDL_FreeSurface( mapImg );
 		close_SDL();
 		return 0;
 	}
 	
+	//and the sprites as pixels, for the software frame buffer
+	PixelImage sprite_pixels, fast_sprite_pixels;
+	SDL_Surface *sprite_surface = SDL_LoadBMP( "./Images/sprite4.bmp" );
+	SDL_Surface *fast_sprite_surface = SDL_LoadBMP( "./Images/fastsprite.bmp" );
+	
+	if( sprite_surface == NULL or fast_sprite_surface == NULL
+		or !load_pixels( sprite_surface, &sprite_pixels ) or !load_pixels( fast_sprite_surface, &fast_sprite_pixels ) ){
+		std::printf( "Sprite pixels not loaded. Error: %s\n", SDL_GetError() );
+		SDL_DestroyTexture( wall_textures );
+		SDL_FreeSurface( mapImg );
+		close_SDL();
+		return 0;
+	}
+	
+	SDL_FreeSurface( sprite_surface );
+	SDL_FreeSurface( fast_sprite_surface );
+	
+	//sprites are drawn column by column too
+	PixelImage sprite_columns, fast_sprite_columns;
+	transpose_pixels( &sprite_pixels, &sprite_columns );
+	transpose_pixels( &fast_sprite_pixels, &fast_sprite_columns );
+	
 	
 	Player player(80.0, 80.0, (7*PI)/2, 10);
 	
@@ -164,10 +276,10 @@ int main( int argc, char* args[] ){
 	std::vector<MapObject*> agent_arr;
 	agent_arr.push_back( &player );
 	for( int i = 0; i < slow_sprite; i++ ){
-		agent_arr.push_back( new Agent( spriteText, 0.0, 0.0, (7*PI)/2, 10, 10, 100.0, 1.5 ) );
+		agent_arr.push_back( new Agent( spriteText, &sprite_columns, 0.0, 0.0, (7*PI)/2, 10, 10, 100.0, 1.5 ) );
 	}
 	for( int i = 0; i < fast_sprite; i++ ){
-		agent_arr.push_back( new Agent( fast_spriteText, 0.0, 0.0, PI/2, 10, 10, 100.0, 1.5 ) );
+		agent_arr.push_back( new Agent( fast_spriteText, &fast_sprite_columns, 0.0, 0.0, PI/2, 10, 10, 100.0, 1.5 ) );
 		agent_arr.back()->double_speed();
 	}
 	
@@ -207,7 +319,14 @@ int main( int argc, char* args[] ){
 	}
 	
 	//creating a map object
-	GameMap gMap( mapImg, wall_textures, dark_wall_textures, 0.75 );
+	//the wall textures in every form the backends draw from
+	WallTextures textures;
+	textures.wall = wall_textures; textures.darkShade = (Uint8)( 255.0*0.75 );
+	textures.indexed = &wall_indexed;
+	
+	GameMap gMap( mapImg, &textures, &colormap, 0.75 );
+	//the map's colors are in the palette now, the fog is the color of the ground
+	colormap.build_table( LIGHT_LEVELS, 0.75, pack_rgb( 50, 50, 50 ) );
 	//GameMap gMap("./Images/spriteTest.bmp");
 	
 	SDL_FreeSurface( mapImg );
@@ -248,7 +367,6 @@ int main( int argc, char* args[] ){
 	if( startScreen == NULL ){
 		std::printf(" Couldnt load start screen. Error: %s\n", SDL_GetError() );
 		SDL_DestroyTexture( wall_textures );
-		SDL_DestroyTexture( dark_wall_textures );
 		close_SDL();
 		return 0;
 	}
@@ -260,7 +378,6 @@ int main( int argc, char* args[] ){
 	if( pauseScreen == NULL ){
 		std::printf(" Couldnt load pause screen. Error: %s\n", SDL_GetError() );
 		SDL_DestroyTexture( wall_textures );
-		SDL_DestroyTexture( dark_wall_textures );
 		SDL_DestroyTexture( startScreen );
 		return 0;
 	}
@@ -307,10 +424,65 @@ int main( int argc, char* args[] ){
 	int width, height;
 	SDL_GetRendererOutputSize( renderer, &width, &height );
 	
-	//to show sky and ground in 3D scene
+	//to show sky and ground in 3D scene, sized to the 3D view every frame
 	SDL_Rect sky, ground;
-	sky.x = 0; sky.y = 0; sky.h = height >> 1; sky.w = width;
-	ground.x = 0; ground.y = height >> 1; ground.h = ground.y; ground.w = width;
+	
+	//projection tables for the window, used by the 2D map and the overlays
+	Camera camera;
+	camera.update( width, height, PI/4 );
+	//and for the 3D view, 45 degrees on either side of the view direction, at the render scale
+	Camera view_camera;
+	
+	//can be changed from the keyboard while playing
+	RenderOptions options;
+	options.drawDist = draw_dist;
+	options.autoDist = false;
+	options.targetFrameTime = target_time;
+	options.traversal = TRAVERSE_STEP;
+	options.reuseFrames = true;
+	options.backend = RENDER_SOFTWARE;
+	options.detail = DETAIL_MIPMAP;
+	options.fog = true;
+	options.fogDist = FOG_DISTANCE;
+	options.floors = true;
+	options.foveaWidth = fovea_width;
+	options.refineStep = refine_step;
+	options.autoScale = render_scale <= 0.0;
+	options.renderScale = options.autoScale ? 1.0 : render_scale;
+	if( options.renderScale > 1.0 )
+		options.renderScale = 1.0;
+	
+	//render times since the render scale last changed
+	ScaleGovernor scale_governor;
+	scale_governor.timeSum = 0.0;
+	scale_governor.frames = 0;
+	
+	//the 3D view is drawn into this on the CPU with RENDER_SOFTWARE
+	FrameBuffer frame;
+	bool frame_ready = frame.resize( renderer, width, height );
+	
+	//and the walls are gathered into this with RENDER_GEOMETRY
+	WallBatch wall_batch;
+	bool batch_ready = wall_batch.load_atlas( renderer, &wall_pixels, 0.75 );
+	
+	if( !frame_ready )
+		options.backend = batch_ready ? RENDER_GEOMETRY : RENDER_DRAW_CALLS;
+	
+	//the explored map at every zoom of the top down view, filled in as blocks are seen
+	MapPyramid map_pyramid;
+	bool pyramid_ready = map_pyramid.create( renderer, gMap.map_width(), gMap.map_height() );
+	
+	//worker threads for ray casting, and the per-column results they write into
+	RayPool ray_pool( ray_threads );
+	HitBuffer hits;
+	
+	//last frame's hits, reused while the player only turns
+	FrameCache frame_cache;
+	frame_cache.valid = false;
+	frame_cache.reused = frame_cache.cast = 0;
+	frame_cache.approximate = false;
+	for( int r = 0; r < FOVEA_REGIONS; r++ )
+		frame_cache.regionColumns[r] = frame_cache.regionCast[r] = 0;
 	
 	double total_time;
 	total_time = 0;
@@ -328,6 +500,12 @@ int main( int argc, char* args[] ){
 				case SDL_QUIT:
 					running = false;
 					break;
+				
+				//the renderer lost what was drawn into textures, the map pyramid starts over
+				case SDL_RENDER_TARGETS_RESET:
+					map_pyramid.release();
+					gMap.redraw_seen();
+					break;
 					
 				case SDL_KEYDOWN:
 					
@@ -337,10 +515,163 @@ int main( int argc, char* args[] ){
 							paused = true;
 							break;
 						
+						//zoom the top down view in and out
+						case SDLK_EQUALS:
+						case SDLK_KP_PLUS:
+							gMap.zoom_2d_map( -1 );
+							break;
+						case SDLK_MINUS:
+						case SDLK_KP_MINUS:
+							gMap.zoom_2d_map( 1 );
+							break;
+						
 						//switch between 3D and top down view if tab is pressed
 						case SDLK_TAB:
 							show3D = !show3D;
 							break;
+						
+						//cycle between stepping through every block, skipping empty space
+						//and stepping in fixed point
+						case SDLK_F1:
+							if( options.traversal == TRAVERSE_STEP ){
+								options.traversal = TRAVERSE_SKIP;
+								std::printf( "Ray traversal: empty space skipping\n" );
+							}else if( options.traversal == TRAVERSE_SKIP ){
+								options.traversal = TRAVERSE_FIXED;
+								std::printf( "Ray traversal: fixed point block stepping\n" );
+							}else{
+								options.traversal = TRAVERSE_STEP;
+								std::printf( "Ray traversal: block stepping\n" );
+							}
+							break;
+						
+						//cycle between a fixed, an unbounded and an automatic draw distance
+						case SDLK_F2:
+							if( options.autoDist ){
+								options.autoDist = false;
+								options.drawDist = FIXED_DRAW_DISTANCE;
+								std::printf( "Draw distance: %d blocks\n", (int)FIXED_DRAW_DISTANCE );
+							}else if( options.drawDist > 0.0 ){
+								options.drawDist = 0.0;
+								std::printf( "Draw distance: unbounded\n" );
+							}else{
+								options.autoDist = true;
+								std::printf( "Draw distance: automatic\n" );
+							}
+							break;
+						
+						//toggle reusing the last frame's hits while only turning
+						case SDLK_F3:
+							options.reuseFrames = !options.reuseFrames;
+							std::printf( "Frame reuse: %s (last frame: %d columns reused, %d cast)\n",
+										options.reuseFrames ? "on" : "off", frame_cache.reused, frame_cache.cast );
+							break;
+						
+						//cycle between the software frame buffer, batched geometry and one draw call per column
+						//skipping any that couldn't be set up
+						case SDLK_F4:
+							if( options.backend == RENDER_SOFTWARE and batch_ready ){
+								options.backend = RENDER_GEOMETRY;
+								std::printf( "Renderer: batched geometry\n" );
+							}else if( options.backend == RENDER_GEOMETRY ){
+								options.backend = RENDER_DRAW_CALLS;
+								std::printf( "Renderer: hardware draw calls (last batched frame: %d quads)\n",
+											wall_batch.lastQuads );
+							}else if( options.backend != RENDER_DRAW_CALLS ){
+								options.backend = RENDER_DRAW_CALLS;
+								std::printf( "Renderer: hardware draw calls\n" );
+							}else if( frame_ready ){
+								options.backend = RENDER_SOFTWARE;
+								std::printf( "Renderer: software frame buffer\n" );
+							}else if( batch_ready ){
+								options.backend = RENDER_GEOMETRY;
+								std::printf( "Renderer: batched geometry\n" );
+							}
+							break;
+						
+						//cycle between full textures, mipmaps and flat colored far walls
+						case SDLK_F5:
+							if( options.detail == DETAIL_FULL ){
+								options.detail = DETAIL_MIPMAP;
+								std::printf( "Wall detail: mipmapped\n" );
+							}else if( options.detail == DETAIL_MIPMAP ){
+								options.detail = DETAIL_FLAT;
+								std::printf( "Wall detail: mipmapped, flat colored far walls\n" );
+							}else{
+								options.detail = DETAIL_FULL;
+								std::printf( "Wall detail: full textures\n" );
+							}
+							break;
+							
+						//switch the distance fog on and off
+						case SDLK_F6:
+							options.fog = !options.fog;
+							std::printf( "Distance fog: %s\n", options.fog ? "on" : "off" );
+							break;
+							
+						//switch between textured floors and ceilings and the plain sky and ground
+						case SDLK_F7:
+							options.floors = !options.floors;
+							std::printf( "Floors and ceilings: %s\n", options.floors ? "textured" : "plain" );
+							break;
+						
+						//cycle between an automatic render scale, the full window and half of it
+						case SDLK_F8:
+							if( options.autoScale ){
+								options.autoScale = false;
+								options.renderScale = 1.0;
+								std::printf( "Render scale: full\n" );
+							}else if( options.renderScale == 1.0 ){
+								options.renderScale = 0.5;
+								std::printf( "Render scale: half\n" );
+							}else{
+								options.autoScale = true;
+								std::printf( "Render scale: automatic (now %.0f%%)\n", options.renderScale*100.0 );
+							}
+							break;
+						
+						//cycle the ray density between every column, a balanced and a fast foveated preset
+						//the rays cast in each region are for the last frame, before the switch
+						case SDLK_F9:
+							if( options.foveaWidth >= 1.0 )
+								options.foveaWidth = FOVEA_BALANCED;
+							else if( options.foveaWidth > FOVEA_FAST )
+								options.foveaWidth = FOVEA_FAST;
+							else
+								options.foveaWidth = 1.0;
+							
+							if( options.foveaWidth >= 1.0 )
+								std::printf( "Ray density: every column" );
+							else
+								std::printf( "Ray density: foveated, full in the center %.0f%%", options.foveaWidth*100.0 );
+							std::printf( " (last frame: center %d/%d cast, middle %d/%d, edges %d/%d)\n",
+										frame_cache.regionCast[0], frame_cache.regionColumns[0],
+										frame_cache.regionCast[1], frame_cache.regionColumns[1],
+										frame_cache.regionCast[2], frame_cache.regionColumns[2] );
+							break;
+						
+						//switch between casting every column and refining from every few columns
+						//foveated casting takes precedence while it's on
+						case SDLK_F10:
+							options.refineStep = options.refineStep > 1 ? 1 : ( refine_step > 1 ? refine_step : REFINE_STEP );
+							if( options.refineStep > 1 )
+								std::printf( "Edge refinement: every %d columns", options.refineStep );
+							else
+								std::printf( "Edge refinement: off" );
+							std::printf( " (last frame: %d rays cast for %d columns)\n", frame_cache.cast, view_camera.wid );
+							break;
+						
+						//switch the software frame buffer between row major and column major pixels
+						//the times are averaged over the frames presented with the layout that's left
+						case SDLK_F11:
+							if( frame.presents > 0 )
+								std::printf( "Frame buffer: %s (last %d frames: transpose %.3f ms, upload %.3f ms)\n",
+											frame.columnMajor ? "row major" : "column major", frame.presents,
+											frame.transposeTime*1000.0/frame.presents, frame.uploadTime*1000.0/frame.presents );
+							else
+								std::printf( "Frame buffer: %s\n", frame.columnMajor ? "row major" : "column major" );
+							frame.set_layout( !frame.columnMajor );
+							break;
 							
 						default:
 							//any other key presses are dealt with by the input function
@@ -441,19 +772,67 @@ int main( int argc, char* args[] ){
 			
 			if( show3D ){
 				
-				SDL_RenderClear( renderer );
+				std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+				
+				//the 3D view is cast and drawn at the render scale, and stretched over the window
+				int viewWid = (int)( width*options.renderScale );
+				int viewHig = (int)( height*options.renderScale );
+				viewWid = viewWid > 0 ? viewWid : 1;
+				viewHig = viewHig > 0 ? viewHig : 1;
+				view_camera.update( viewWid, viewHig, PI/4 );
+				
+				if( options.backend == RENDER_SOFTWARE && !frame.resize( renderer, viewWid, viewHig ) ){
+					frame_ready = false;
+					options.backend = batch_ready ? RENDER_GEOMETRY : RENDER_DRAW_CALLS;
+				}
 				
-				//sky is a light blue color
-				SDL_SetRenderDrawColor( renderer, 69, 250, 254, 255 );
-				SDL_RenderFillRect( renderer, &sky );
-				//ground is a dark gray color
-				SDL_SetRenderDrawColor( renderer, 50, 50, 50, 255 );
-				SDL_RenderFillRect( renderer, &ground );
+				sky.x = 0; sky.y = 0; sky.h = viewHig >> 1; sky.w = viewWid;
+				ground.x = 0; ground.y = sky.h; ground.h = viewHig - ground.y; ground.w = viewWid;
+				
+				//sprites go into the frame buffer, or straight onto the renderer when this is NULL
+				//they don't go through the wall batch
+				FrameBuffer *target = options.backend == RENDER_SOFTWARE ? &frame : NULL;
+				
+				if( options.backend == RENDER_SOFTWARE ){
+					//sky is a light blue color, ground is a dark gray color
+					frame.fill_rows( 0, sky.h, pack_rgb( 69, 250, 254 ) );
+					frame.fill_rows( ground.y, ground.y + ground.h, pack_rgb( 50, 50, 50 ) );
+				}else{
+					SDL_RenderClear( renderer );
+					
+					//everything up to the sprites is drawn in 3D view coordinates
+					SDL_RenderSetScale( renderer, (float)width/viewWid, (float)height/viewHig );
+					
+					//sky is a light blue color
+					SDL_SetRenderDrawColor( renderer, 69, 250, 254, 255 );
+					SDL_RenderFillRect( renderer, &sky );
+					//ground is a dark gray color
+					SDL_SetRenderDrawColor( renderer, 50, 50, 50, 255 );
+					SDL_RenderFillRect( renderer, &ground );
+				}
 				
 				//cast rays and draw the environment on the screen
-				castRays( &gMap, &player, renderer, 45, DEPTH_OF_FIELD );
+				castRays( &gMap, &player, renderer, &frame, &wall_batch, &colormap, &view_camera, &options, &ray_pool, &frame_cache, hits );
+			
+				//floors go in around the walls, and under the sprites
+				if( options.backend == RENDER_SOFTWARE && options.floors )
+					floor_caster.draw( &frame, player.x, player.y, player.ang, &view_camera, hits,
+									options.fog ? &colormap : NULL, options.fogDist*BLOCK_DIM );
 			
-				draw_3D_sprites( renderer, &gMap, &player, agent_arr, 0.7853981633974483 );
+				draw_3D_sprites( renderer, target, &player, agent_arr, &view_camera, hits, max_ray_dist( &options ) );
+				
+				//the whole frame goes up in one upload, stretched over the window
+				if( options.backend == RENDER_SOFTWARE )
+					frame.present( renderer );
+				else
+					SDL_RenderSetScale( renderer, 1.0f, 1.0f );
+				
+				//time spent on the 3D view, for the automatic draw distance and render scale
+				//with the software backend, that includes turning the pixels round and uploading them
+				double renderTime = std::chrono::duration_cast<std::chrono::microseconds>(
+										std::chrono::steady_clock::now() - renderStart ).count()*0.000001;
+				adapt_draw_distance( &options, renderTime );
+				adapt_render_scale( &options, &scale_governor, renderTime );
 				
 			}else{
 				
@@ -462,11 +841,11 @@ int main( int argc, char* args[] ){
 				SDL_RenderClear( renderer );
 				
 				//draw the 2D map top down view
-				gMap.draw2DMap( renderer , player.x, player.y );
+				gMap.draw2DMap( renderer, &camera, pyramid_ready ? &map_pyramid : NULL, player.x, player.y );
 				
 				//draw all the players on the map
 				for( int i = 0; i < (int)agent_arr.size(); i++ )
-					agent_arr[i]->sprite2D( renderer );
+					agent_arr[i]->sprite2D( renderer, &camera, gMap.map_zoom() );
 			}
 			
 			total_time += dt;
@@ -474,13 +853,13 @@ int main( int argc, char* args[] ){
 			
 			if( total_time > 0.1 ){
 				avg_frame_rate = (double)(frames)/total_time;
-				frame_rate( renderer, numbers, avg_frame_rate );
+				frame_rate( renderer, &camera, numbers, avg_frame_rate );
 				total_time = 0.0;
 				frames = 0;
 				//if( avg_frame_rate < 40 )
 					//std::printf( "Very Low Framerate: %d\n", avg_frame_rate );
 			}else{
-				frame_rate( renderer, numbers, avg_frame_rate );
+				frame_rate( renderer, &camera, numbers, avg_frame_rate );
 			}
 			
 			SDL_RenderPresent( renderer );
@@ -540,7 +919,6 @@ int main( int argc, char* args[] ){
 	
 	//wrapping up everything
 	SDL_DestroyTexture( wall_textures );
-	SDL_DestroyTexture( dark_wall_textures );
 	close_SDL();
 	
 	return 0;
@@ -1,31 +1,46 @@
 #include <helper.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
 #define PI 3.1415926535897932384
 
 const unsigned BLOCK_DIM = 64;
 const unsigned TILESHIFT = 6;
-const int DEPTH_OF_FIELD = 20;
 
-void create_dark_walls(SDL_Surface *wall_textures, SDL_Surface *dark_wall_textures, double wallColorRatio){
-	
-	SDL_LockSurface(wall_textures);
-	Uint8 *pixel = ((Uint8*)wall_textures->pixels);
-	SDL_UnlockSurface(wall_textures);
-	
-	SDL_LockSurface(dark_wall_textures);
-	Uint8 *dark_pixel = ((Uint8*)dark_wall_textures->pixels);
-	SDL_UnlockSurface(dark_wall_textures);
-	
-	for( int i = 0; i < dark_wall_textures->h; i++ ){
-		for( int j = 0; j < dark_wall_textures->pitch; j+=3 ){
-			for( int k = 0; k < 3; k++ )
-				dark_pixel[i*dark_wall_textures->pitch + j + k] 
-					= (Uint8)( wallColorRatio*pixel[i*wall_textures->pitch + j + k] );
-		}
-	}
-	
-}
+//fraction of the draw distance over which walls fade out
+const double FADE_RANGE = 0.25;
+
+//bounds for the automatic draw distance, in blocks
+const double MIN_DRAW_DIST = 4.0;
+const double MAX_DRAW_DIST = 256.0;
 
-void frame_rate( SDL_Renderer *renderer, SDL_Texture *numbers, int fps ){
+//the automatic render scale moves in steps of this much, and never goes below MIN_RENDER_SCALE
+const double RENDER_SCALE_STEP = 1.0/16.0;
+const double MIN_RENDER_SCALE = 0.25;
+//frames averaged before the render scale is changed
+const int RENDER_SCALE_FRAMES = 10;
+//the scale goes down above this fraction of the target time, and only goes up if the next step
+//is expected to stay below the lower one
+const double RENDER_SCALE_HIGH = 1.1;
+const double RENDER_SCALE_LOW = 0.85;
+
+//how far, in map units, rounding can move a fixed point intercept of cast_ray_fixed, once when it's set up
+//and once more for every grid line it's stepped over: half of the last of the 16 fractional bits
+const double FIXED_ROUNDING = 0.5/65536.0;
+
+//how far, in texels, a merged wall span may map its texture away from where the columns hit it
+const double SPAN_TEXEL_ERROR = 0.5;
+//how much taller one end of a merged wall span may be than the other
+const double SPAN_HEIGHT_RATIO = 1.05;
+
+//walls shorter than this many pixels are drawn in a flat color with DETAIL_FLAT
+const double FLAT_WALL_HIG = 6.0;
+
+void frame_rate( SDL_Renderer *renderer, Camera *cam, SDL_Texture *numbers, int fps ){
 	
 	if( fps > 99 )
 		return;
@@ -35,8 +50,7 @@ void frame_rate( SDL_Renderer *renderer, SDL_Texture *numbers, int fps ){
 	digs[0] = (int)( fps/10 );
 	digs[1] = fps % 10;
 	
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
+	int wid = cam->wid;
 	
 	SDL_Rect srcRect, dstRect;
 	srcRect.x = 5*digs[1]; srcRect.y = 0;
@@ -61,8 +75,9 @@ bool checkWhiteBlock( GameMap *gMap, MapObject *player ){
 	int mapX, mapY;
 	
 	//finding where the point right in front of the player lies in the map array
-	mapX = (int)( player->x + std::cos(player->ang)*(double)player->objDim ) >> TILESHIFT;
-	mapY = (int)( player->y - std::sin(player->ang)*(double)player->objDim ) >> TILESHIFT;
+	bam_t ang = rad_to_bam( player->ang );
+	mapX = (int)( player->x + bam_cos(ang)*(double)player->objDim ) >> TILESHIFT;
+	mapY = (int)( player->y - bam_sin(ang)*(double)player->objDim ) >> TILESHIFT;
 	
 	Block *block = gMap->block_at( mapY, mapX );
 	
@@ -132,90 +147,894 @@ bool input(GameMap *gMap, MapObject *player, std::vector<MapObject*> &agent_arr,
 	return touched;
 }
 
-void castRays(GameMap *gMap, MapObject *player, SDL_Renderer *renderer, int angRange, int depth){
+double max_ray_dist( RenderOptions *opts ){
+	if( opts->drawDist <= 0.0 )
+		return HUGE_VAL;
+	return opts->drawDist*(double)BLOCK_DIM;
+}
+
+void adapt_draw_distance( RenderOptions *opts, double renderTime ){
+	
+	if( !opts->autoDist )
+		return;
+	
+	//an unbounded distance has to start shrinking from somewhere
+	if( opts->drawDist <= 0.0 )
+		opts->drawDist = MAX_DRAW_DIST;
+	
+	//small steps so that the walls don't visibly jump back and forth,
+	//and a dead zone around the target so it settles down
+	if( renderTime > opts->targetFrameTime*1.1 )
+		opts->drawDist *= 0.95;
+	else if( renderTime < opts->targetFrameTime*0.9 )
+		opts->drawDist *= 1.02;
+	
+	if( opts->drawDist < MIN_DRAW_DIST )
+		opts->drawDist = MIN_DRAW_DIST;
+	if( opts->drawDist > MAX_DRAW_DIST )
+		opts->drawDist = MAX_DRAW_DIST;
+}
+
+void adapt_render_scale( RenderOptions *opts, ScaleGovernor *gov, double renderTime ){
 	
-	//dimensions of the screen
-	int wid, hig;
-	SDL_GetRendererOutputSize( renderer, &wid, &hig );
+	if( !opts->autoScale ){
+		gov->timeSum = 0.0;
+		gov->frames = 0;
+		return;
+	}
 	
-	//range of angles in which the rays are casted (in radians)
-	double radAngRange = (PI*angRange)/180.0;
-	//num of rays casted
-	int rayCount = wid;
+	gov->timeSum += renderTime;
+	gov->frames++;
+	
+	//single slow frames don't change anything, only a few in a row do
+	if( gov->frames < RENDER_SCALE_FRAMES )
+		return;
+	
+	double avgTime = gov->timeSum/gov->frames;
+	gov->timeSum = 0.0;
+	gov->frames = 0;
+	
+	double scale = opts->renderScale;
+	
+	if( avgTime > opts->targetFrameTime*RENDER_SCALE_HIGH ){
+		scale -= RENDER_SCALE_STEP;
+	}else if( scale < 1.0 ){
+		//the render time goes roughly with the number of pixels, the square of the scale
+		//the scale only goes up if that still leaves room below the target, so that it doesn't
+		//go straight back down after the next few frames and keep flipping between two steps
+		double up = scale + RENDER_SCALE_STEP;
+		double growth = ( up*up )/( scale*scale );
+		if( avgTime*growth < opts->targetFrameTime*RENDER_SCALE_LOW )
+			scale = up;
+	}
 	
-	//distance away from the player where the "screen" is situated.
-	//all rays are projected onto this screen
-	double screenDist = (double)wid/( 2*std::tan(radAngRange) );
+	if( scale < MIN_RENDER_SCALE )
+		scale = MIN_RENDER_SCALE;
+	if( scale > 1.0 )
+		scale = 1.0;
+	
+	opts->renderScale = scale;
+}
+
+//picks the mip level for a wall slice rayHig pixels tall, the smallest one that still has
+//at least as many texels as the slice has pixels
+static int wall_mip( double rayHig, WallDetail detail ){
+	
+	if( detail == DETAIL_FULL )
+		return 0;
+	if( detail == DETAIL_FLAT && rayHig < FLAT_WALL_HIG )
+		return MIP_LEVELS - 1;
+	
+	int mip = 0;
+	while( mip < MIP_LEVELS - 1 && (double)( BLOCK_DIM >> ( mip + 1 ) ) >= rayHig )
+		mip++;
+	
+	return mip;
+}
+
+//finds the run of columns starting at start that show the same wall face, and can be drawn as
+//one trapezoid without the texture visibly sliding, returns one past its last column
+//the renderer maps textures linearly, so the run stops where that drifts more than SPAN_TEXEL_ERROR
+//from the actual texture offsets, or where the wall height changes so much that the two triangles
+//of the trapezoid bend the texture. Faded columns are never merged
+static int span_end( const HitBuffer &hits, Camera *cam, double fadeDist, int start, WallSpan *span ){
+	
+	int wid = cam->wid;
+	
+	if( hits.dist[start]/cam->colCos[start] > fadeDist )
+		return start + 1;
+	
+	double firstHig = (double)BLOCK_DIM*cam->screenDist/hits.dist[start];
+	
+	//texture offsets change linearly from the first column, by a slope that stays in this range
+	//for every column seen so far. The offsets are sampled in the middle of each column
+	double firstU = hits.offset[start] + 0.5;
+	double slopeMin = -HUGE_VAL, slopeMax = HUGE_VAL;
+	
+	int end = start + 1;
+	
+	for( ; end < wid; end++ ){
+		
+		if( hits.cell[end] != hits.cell[start] || hits.side[end] != hits.side[start] || hits.dist[end] == 0.0 )
+			break;
+		if( hits.dist[end]/cam->colCos[end] > fadeDist )
+			break;
+		
+		double nextHig = (double)BLOCK_DIM*cam->screenDist/hits.dist[end];
+		if( nextHig > firstHig*SPAN_HEIGHT_RATIO || firstHig > nextHig*SPAN_HEIGHT_RATIO )
+			break;
+		
+		double lo = ( hits.offset[end] + 0.5 - SPAN_TEXEL_ERROR - firstU )/( end - start );
+		double hi = ( hits.offset[end] + 0.5 + SPAN_TEXEL_ERROR - firstU )/( end - start );
+		if( lo > slopeMax || hi < slopeMin )
+			break;
+		slopeMin = lo > slopeMin ? lo : slopeMin;
+		slopeMax = hi < slopeMax ? hi : slopeMax;
+	}
+	
+	if( end - start < 2 )
+		return end;
+	
+	int last = end - 1;
+	double lastHig = (double)BLOCK_DIM*cam->screenDist/hits.dist[last];
+	
+	//the wall height is exactly linear across a flat wall, so the edges of the span
+	//are found by stretching the middles of the first and last column out by half a pixel
+	double higSlope = ( lastHig - firstHig )/( last - start );
+	double hig0 = firstHig - 0.5*higSlope;
+	double hig1 = lastHig + 0.5*higSlope;
+	
+	double slope = 0.5*( slopeMin + slopeMax );
+	double u0 = firstU - 0.5*slope;
+	double u1 = firstU + slope*( last - start + 0.5 );
+	
+	span->x0 = (float)start;
+	span->x1 = (float)end;
+	span->top0 = (float)( 0.5*( cam->hig - hig0 ) ); span->bottom0 = (float)( 0.5*( cam->hig + hig0 ) );
+	span->top1 = (float)( 0.5*( cam->hig - hig1 ) ); span->bottom1 = (float)( 0.5*( cam->hig + hig1 ) );
+	//never reaching into the next texture of the atlas
+	span->u0 = (float)( u0 < 0.0 ? 0.0 : ( u0 > BLOCK_DIM ? BLOCK_DIM : u0 ) );
+	span->u1 = (float)( u1 < 0.0 ? 0.0 : ( u1 > BLOCK_DIM ? BLOCK_DIM : u1 ) );
+	
+	return end;
+}
+
+//casts a single ray with the chosen traversal
+static void cast_single( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist,
+						TraversalMode mode, RayHit *hit ){
+	if( mode == TRAVERSE_SKIP )
+		cast_ray_skip( gMap, posX, posY, rAng, maxDist, hit );
+	else if( mode == TRAVERSE_FIXED )
+		cast_ray_fixed( gMap, posX, posY, rAng, maxDist, hit );
+	else
+		cast_ray( gMap, posX, posY, rAng, maxDist, hit );
+}
+
+//works out where a ray hits the wall line already in hit, the way the chosen traversal would
+static void hit_on_line( GameMap *gMap, double posX, double posY, bam_t rAng, TraversalMode mode, RayHit *hit ){
+	if( mode == TRAVERSE_FIXED )
+		ray_hit_on_line_fixed( gMap, posX, posY, rAng, hit );
+	else
+		ray_hit_on_line( posX, posY, rAng, hit );
+}
+
+//if every ray between the rays of columns a and b hits the same wall as both of them do
+//it can only be something else if a block fits in between the two rays, which can't happen
+//if the wedge between them is narrower than a block where it ends at the wall
+static bool same_wall_between( const RayHit &left, const RayHit &right, Camera *cam, int a, int b ){
+	
+	bool sameLine = left.hit && right.hit && left.isVertical == right.isVertical
+					&& left.mapX == right.mapX && left.mapY == right.mapY;
+	double wedge = ( left.dist > right.dist ? left.dist : right.dist )*( cam->colAng[a] - cam->colAng[b] );
+	
+	return sameLine && wedge < (double)BLOCK_DIM;
+}
+
+//everything the wall kernels draw with, the same for every column of a frame
+struct WallDraw{
+	SDL_Renderer *renderer;
+	FrameBuffer *frame;
+	WallBatch *batch;
+	const ColorMap *colormap;
+	const WallTextures *textures;
+	RenderBackend backend;
+};
+
+//where a wall column goes on the screen, and how its texture is sampled
+struct WallSlice{
+	SDL_Rect rect;
+	int offset_y;
+	Uint8 alpha;
+	//mip level for the software backend
+	int mip;
+	//row of the color map for the column's side and fog, for the software backend
+	const Uint32 *shade;
+};
+
+//works out the slice of column i of the hit buffer
+static void wall_slice( const HitBuffer &hits, int i, Camera *cam, RenderOptions *opts, const ColorMap *colormap,
+						double maxDist, double fadeDist, double fogDist, WallSlice *slice ){
+	
+	int hig = cam->hig;
 	
 	//the height of the slice of the wall where the ray hits
-	double rayHig;
+	double rayHig = ( (double)BLOCK_DIM * cam->screenDist )/hits.dist[i];
 	
-	//map indices where the ray hits the wall
-	int vmapX, vmapY, hmapX, hmapY;
+	//far walls are sampled from a smaller texture, or drawn flat
+	slice->mip = opts->backend == RENDER_SOFTWARE ? wall_mip( rayHig, opts->detail ) : 0;
 	
-	vmapX = vmapY = hmapX = hmapY = 0;
+	//if slice height is lesser than screen height, texture doesn't get clipped
+	//but if slice height is greater than, then the texture has to be clipped
+	//from above and below to coincide with the field of view of the player
+	slice->offset_y = 0;
 	
-	for( int i = 0; i < rayCount; i++ ){
+	if( rayHig > hig ){
+		slice->offset_y = (int)(((rayHig - (double)hig)*(double)BLOCK_DIM)/(2.0*rayHig));
+	}
+	
+	//capping ray height at screen height
+	rayHig = rayHig > hig ? (double)hig : rayHig;
+	
+	slice->rect.y = (hig - (int)rayHig) >> 1; slice->rect.x = i;
+	slice->rect.h = (int)rayHig; slice->rect.w = 1;
+	
+	//walls close to the draw distance fade into the background, so that they don't just pop out
+	//the fade goes by the distance along the ray, same as the cutoff
+	slice->alpha = 255;
+	double rayDist = hits.dist[i]/cam->colCos[i];
+	if( rayDist > fadeDist )
+		slice->alpha = (Uint8)( 255.0*( maxDist - rayDist )/( maxDist - fadeDist ) );
+	
+	slice->shade = NULL;
+	if( opts->backend == RENDER_SOFTWARE ){
+		//the side and the fog are one row of the color map
+		int fog = 0;
+		if( opts->fog )
+			fog = rayDist < fogDist ? (int)( rayDist*( colormap->lightLevels - 1 )/fogDist ) : colormap->lightLevels - 1;
+		slice->shade = colormap->shade( hits.side[i], fog );
+	}
+}
+
+//draws one wall column of a material of the given kind, with whichever backend the frame uses
+template<MaterialKind kind>
+static void draw_wall_column( const WallDraw &draw, const Material &m, WallSlice *slice, int offset, bool isVert );
+
+template<>
+void draw_wall_column<MATERIAL_COLOR>( const WallDraw &draw, const Material &m, WallSlice *slice, int, bool isVert ){
+	
+	//texture offset doesn't matter, just fill the rect with the material's color
+	const Uint8 *color = isVert ? m.dark_colors : m.colors;
+	SDL_Rect *rect = &slice->rect;
+	
+	switch( draw.backend ){
+		case RENDER_SOFTWARE:
+			draw.frame->fill_column( rect->x, rect->y, rect->h, slice->shade[m.paletteIndex], slice->alpha );
+			break;
+		case RENDER_GEOMETRY:
+			draw.batch->add_color_column( rect, color[0], color[1], color[2], slice->alpha );
+			break;
+		default:
+			SDL_SetRenderDrawColor( draw.renderer, color[0], color[1], color[2], slice->alpha );
+			SDL_RenderFillRect( draw.renderer, rect );
+	}
+}
+
+template<>
+void draw_wall_column<MATERIAL_TEXTURE>( const WallDraw &draw, const Material &m, WallSlice *slice, int offset, bool isVert ){
+	
+	SDL_Rect *rect = &slice->rect;
+	int offset_y = slice->offset_y;
+	int mip = slice->mip;
+	
+	//first the material's texture is found, then the horiz offset is applied
+	int srcX = m.textureOffset + offset;
+	int srcH = BLOCK_DIM - ( offset_y << 1 );
+	
+	if( draw.backend == RENDER_GEOMETRY ){
+		//the dark side is tinted by the batch
+		draw.batch->add_textured_column( rect, srcX, offset_y, srcH, isVert, slice->alpha );
 		
-		//angle is calculated by atan
-		double rAng = mod2PI( player->ang + modPI( real_atan( screenDist, (double) ( ( wid >> 1 ) - i ) ) ) );
+	}else if( draw.backend == RENDER_DRAW_CALLS ){
+		SDL_Rect srcRect;
+		srcRect.x = srcX; srcRect.y = offset_y;
+		srcRect.w = 1; srcRect.h = srcH;
 		
-		double hDist, vDist;
+		//the dark side is the same texture, tinted the way the batch does it
+		SDL_Texture *texture = draw.textures->wall;
+		Uint8 shade = isVert ? draw.textures->darkShade : 255;
 		
-		//the horiz offset at which a slice of the wall texture is to be
-		//picked
-		int v_offset, h_offset, offset_x;
+		SDL_SetTextureColorMod( texture, shade, shade, shade );
+		SDL_SetTextureAlphaMod( texture, slice->alpha );
+		SDL_RenderCopy( draw.renderer, texture, &srcRect, rect );
 		
-		cast_horiz_ray( gMap, player->x, player->y, rAng, depth, &hmapX, &hmapY, &hDist, &h_offset );
-		cast_vert_ray( gMap, player->x, player->y, rAng, depth, &vmapX, &vmapY, &vDist, &v_offset );
+	}else{
+		//same part of the texture as the draw calls pick, scaled down to the mip level, as palette indices
+		const IndexedImage *columns = &draw.textures->indexed->levels[mip];
 		
-		//which among the two distances is smallest
-		double finalDist;
+		//the last level holds one texel per texture, its average color
+		if( mip == MIP_LEVELS - 1 ){
+			draw.frame->fill_column( rect->x, rect->y, rect->h,
+									slice->shade[columns->pixels[( srcX >> mip )*columns->wid]], slice->alpha );
+			return;
+		}
+		
+		srcH >>= mip;
+		draw.frame->draw_indexed_column( rect->x, rect->y, rect->h, columns,
+										srcX >> mip, offset_y >> mip, srcH > 0 ? srcH : 1, slice->shade, slice->alpha );
+	}
+}
+
+//draws the listed columns of the hit buffer, which all have materials of the given kind
+template<MaterialKind kind>
+static void draw_wall_columns( const WallDraw &draw, GameMap *gMap, const HitBuffer &hits, const std::vector<int> &cols,
+							Camera *cam, RenderOptions *opts, double maxDist, double fadeDist, double fogDist ){
+	
+	for( int i : cols ){
+		WallSlice slice;
+		wall_slice( hits, i, cam, opts, draw.colormap, maxDist, fadeDist, fogDist, &slice );
+		draw_wall_column<kind>( draw, gMap->material( hits.material[i] ), &slice, hits.offset[i], hits.side[i] );
+	}
+}
+
+//adds a whole run of columns showing one wall face to the batch as one trapezoid
+static void batch_wall_span( WallBatch *batch, const Material &m, const WallSpan *span, bool isVert ){
+	
+	if( m.kind == MATERIAL_TEXTURE )
+		batch->add_textured_span( span, m.textureOffset, isVert, 255 );
+	else{
+		const Uint8 *color = isVert ? m.dark_colors : m.colors;
+		batch->add_color_span( span, color[0], color[1], color[2], 255 );
+	}
+}
+
+//which foveated casting region column i lies in, rays are cast 1 << region columns apart in it
+static int fovea_region( Camera *cam, double foveaWidth, int i ){
+	
+	//distance from the center of the screen, 1 at the edges
+	double d = std::fabs( i + 0.5 - 0.5*cam->wid )/( 0.5*cam->wid );
+	
+	if( d < foveaWidth )
+		return 0;
+	if( d < 0.5*( 1.0 + foveaWidth ) )
+		return 1;
+	return 2;
+}
+
+//fills in the hits of the columns between the cast columns a and b
+//if both hit the same wall line the columns in between are taken to hit it too, with the
+//distance and texture offset interpolated the way they change across a flat wall on screen:
+//1/depth and offset/depth go linearly. Otherwise there's a wall edge somewhere in between, and
+//every column copies the closer of the two, so the edge stays sharp and only moves a little
+static void fill_gap( RayHit *hits, int a, int b, Camera *cam ){
+	
+	RayHit &left = hits[a];
+	RayHit &right = hits[b];
+	
+	bool sameLine = left.hit && right.hit && left.isVertical == right.isVertical
+					&& left.mapX == right.mapX && left.mapY == right.mapY
+					&& left.dist > 0.0 && right.dist > 0.0;
+	
+	//depths of both ends without the fish eye
+	double depthA = left.dist*cam->colCos[a], depthB = right.dist*cam->colCos[b];
+	
+	for( int k = a + 1; k < b; k++ ){
 		
-		//the wall where the ray hit
-		Block *wall = NULL;
-		bool isVertical = false;
+		RayHit &hit = hits[k];
 		
-		if( vDist > hDist ){
-			finalDist = hDist;
-			offset_x = h_offset;
-			wall = gMap->horiz_wall_at( hmapY, hmapX );
+		if( sameLine ){
+			double t = (double)( k - a )/( b - a );
+			double invDepth = ( 1.0 - t )/depthA + t/depthB;
+			double u = ( ( 1.0 - t )*( left.offset + 0.5 )/depthA + t*( right.offset + 0.5 )/depthB )/invDepth;
 			
+			hit = left;
+			hit.dist = 1.0/( invDepth*cam->colCos[k] );
+			hit.offset = (int)u;
+			hit.offset = hit.offset < 0 ? 0 : ( hit.offset > (int)BLOCK_DIM - 1 ? BLOCK_DIM - 1 : hit.offset );
 		}else{
-			finalDist = vDist;
-			offset_x = v_offset;
-			wall = gMap->vert_wall_at( vmapY, vmapX );
-			isVertical = true;
+			//same depth as the column it's copied from
+			int from = k - a <= b - k ? a : b;
+			hit = hits[from];
+			hit.dist = hits[from].dist*cam->colCos[from]/cam->colCos[k];
+		}
+	}
+}
+
+//casts the columns start to end - 1 with foveated casting, the first and the last always get a ray
+//and the ones in between are filled in. Rays cast are counted by region in regionCasts
+static void cast_foveated( GameMap *gMap, MapObject *player, bam_t view, Camera *cam, RenderOptions *opts,
+						double maxDist, int start, int end, RayHit *hits, int *regionCasts ){
+	
+	//rays are still cast in packets, of columns that are further apart
+	int cols[RAY_PACKET];
+	bam_t rAng[RAY_PACKET];
+	RayHit packet[RAY_PACKET];
+	int count = 0;
+	
+	//the last column that was cast
+	int prev = -1;
+	
+	for( int i = start; i < end; ){
+		
+		int region = fovea_region( cam, opts->foveaWidth, i );
+		regionCasts[region]++;
+		
+		cols[count] = i;
+		rAng[count] = view + (bam_t)cam->colBam[i];
+		count++;
+		
+		//the last column is cast even if it's not a whole step away
+		int next = i + ( 1 << region );
+		i = next >= end && i < end - 1 ? end - 1 : next;
+		
+		if( count == RAY_PACKET || i >= end ){
+			
+			cast_ray_packet( gMap, player->x, player->y, rAng, count, maxDist, opts->traversal, packet );
 			
+			for( int k = 0; k < count; k++ ){
+				hits[cols[k]] = packet[k];
+				if( prev >= 0 )
+					fill_gap( hits, prev, cols[k], cam );
+				prev = cols[k];
+			}
+			
+			count = 0;
+		}
+	}
+}
+
+//works out the columns between the cast columns a and b, casting rays only where a wall edge
+//could lie in between. Returns the number of rays cast
+static int refine_gap( GameMap *gMap, MapObject *player, bam_t view, Camera *cam, RenderOptions *opts,
+					double maxDist, int a, int b, RayHit *hits ){
+	
+	if( b - a < 2 )
+		return 0;
+	
+	//the rays in between all end on the same wall, where they meet it is worked out from the wall line
+	if( same_wall_between( hits[a], hits[b], cam, a, b ) ){
+		for( int k = a + 1; k < b; k++ ){
+			hits[k] = hits[a];
+			hit_on_line( gMap, player->x, player->y, view + (bam_t)cam->colBam[k], opts->traversal, &hits[k] );
+		}
+		return 0;
+	}
+	
+	//otherwise the middle column is cast, and both halves are looked at again
+	int m = ( a + b ) >> 1;
+	cast_single( gMap, player->x, player->y, view + (bam_t)cam->colBam[m], maxDist, opts->traversal, &hits[m] );
+	
+	return 1 + refine_gap( gMap, player, view, cam, opts, maxDist, a, m, hits )
+			+ refine_gap( gMap, player, view, cam, opts, maxDist, m, b, hits );
+}
+
+//casts the columns start to end - 1 with edge refinement, every refineStep-th one and the last
+//one are cast in packets first, and the gaps are refined after. Rays cast are counted by
+//foveated casting region in regionCasts, like for the other ways of casting
+static void cast_refined( GameMap *gMap, MapObject *player, bam_t view, Camera *cam, RenderOptions *opts,
+						double maxDist, int start, int end, RayHit *hits, int *regionCasts ){
+	
+	int cols[RAY_PACKET];
+	bam_t rAng[RAY_PACKET];
+	RayHit packet[RAY_PACKET];
+	int count = 0;
+	
+	//the last column that was cast
+	int prev = -1;
+	
+	for( int i = start; i < end; ){
+		
+		regionCasts[fovea_region( cam, opts->foveaWidth, i )]++;
+		
+		cols[count] = i;
+		rAng[count] = view + (bam_t)cam->colBam[i];
+		count++;
+		
+		int next = i + opts->refineStep;
+		i = next >= end && i < end - 1 ? end - 1 : next;
+		
+		if( count == RAY_PACKET || i >= end ){
+			
+			cast_ray_packet( gMap, player->x, player->y, rAng, count, maxDist, opts->traversal, packet );
+			
+			for( int k = 0; k < count; k++ ){
+				hits[cols[k]] = packet[k];
+				if( prev >= 0 ){
+					int casts = refine_gap( gMap, player, view, cam, opts, maxDist, prev, cols[k], hits );
+					//the casts are counted by where the gap is, they all lie within it
+					regionCasts[fovea_region( cam, opts->foveaWidth, ( prev + cols[k] ) >> 1 )] += casts;
+				}
+				prev = cols[k];
+			}
+			
+			count = 0;
+		}
+	}
+}
+
+//if the last frame's hits can be reused for this frame
+static bool cache_usable( FrameCache *cache, GameMap *gMap, MapObject *player, Camera *cam,
+						RenderOptions *opts, double maxDist ){
+	
+	//any movement at all, or anything else changing, means everything gets cast again
+	return opts->reuseFrames && cache->valid
+		&& !cache->approximate && cache->x == player->x && cache->y == player->y
+		&& cache->gMap == gMap && cache->maxDist == maxDist && cache->traversal == opts->traversal
+		&& cache->wid == cam->wid && cache->spread == cam->spread
+		&& (int)cache->prevHits.size() == cam->wid;
+}
+
+void castRays(GameMap *gMap, MapObject *player, SDL_Renderer *renderer, FrameBuffer *frame, WallBatch *batch,
+			const ColorMap *colormap, Camera *cam, RenderOptions *opts, RayPool *pool, FrameCache *cache,
+			HitBuffer &hits){
+	
+	//num of rays casted
+	int rayCount = cam->wid;
+	
+	double maxDist = max_ray_dist( opts );
+	
+	//walls start fading out at this distance
+	double fadeDist = maxDist*( 1.0 - FADE_RANGE );
+	//and are fully in the fog at this one, with the fog on
+	double fogDist = opts->fogDist*BLOCK_DIM;
+	
+	hits.resize( rayCount );
+	
+	//last frame's hits are kept around in prevHits
+	cache->hits.swap( cache->prevHits );
+	cache->hits.resize( rayCount );
+	
+	bool reuse = cache_usable( cache, gMap, player, cam, opts, maxDist );
+	
+	//view direction, the column angles are added to it and wrap around on their own
+	bam_t view = rad_to_bam( player->ang );
+	
+	//how far the player turned since the last frame
+	Sint64 turn = reuse ? (Sint32)( view - cache->ang ) : 0;
+	
+	//columns that had to be cast anew, summed over all strips
+	std::atomic<int> recast( 0 );
+	//and the same by foveated casting region
+	std::atomic<int> regionCast[FOVEA_REGIONS];
+	for( int r = 0; r < FOVEA_REGIONS; r++ )
+		regionCast[r] = 0;
+	
+	//far from the center of the screen only some columns are cast
+	bool foveated = !reuse && opts->foveaWidth < 1.0;
+	
+	//first pass: casting, every strip of columns only writes its own part of the buffer
+	pool->run( rayCount, [&]( int start, int end ){
+		
+		int casts = 0;
+		int regionCasts[FOVEA_REGIONS] = { 0, 0, 0 };
+		
+		if( reuse ){
+			
+			for( int i = start; i < end; i++ ){
+				
+				RayHit &hit = cache->hits[i];
+				bam_t rAng = view + (bam_t)cam->colBam[i];
+				
+				//this column's angle in the last frame's view, the column angles go down
+				//from left to right, so the last frame's columns on either side of it are looked up
+				Sint64 prevAng = cam->colBam[i] + turn;
+				int j = (int)( std::upper_bound( cam->colBam.begin(), cam->colBam.end(), prevAng,
+												std::greater<Sint64>() ) - cam->colBam.begin() );
+				
+				if( j > 0 && cam->colBam[j - 1] == prevAng ){
+					//exactly the same ray as last frame
+					hit = cache->prevHits[j - 1];
+					continue;
+				}
+				
+				if( j > 0 && j < rayCount ){
+					
+					RayHit &left = cache->prevHits[j - 1];
+					RayHit &right = cache->prevHits[j];
+					
+					//if both neighbours hit the same wall, so does this ray
+					if( same_wall_between( left, right, cam, j - 1, j ) ){
+						hit = left;
+						hit_on_line( gMap, player->x, player->y, rAng, opts->traversal, &hit );
+						continue;
+					}
+				}
+				
+				//newly exposed at the edge of the screen, or a wall edge lies between the neighbours
+				cast_single( gMap, player->x, player->y, rAng, maxDist, opts->traversal, &hit );
+				regionCasts[fovea_region( cam, opts->foveaWidth, i )]++;
+			}
+			
+		}else if( foveated ){
+			
+			cast_foveated( gMap, player, view, cam, opts, maxDist, start, end, &cache->hits[0], regionCasts );
+			
+		}else if( opts->refineStep > 1 ){
+			
+			cast_refined( gMap, player, view, cam, opts, maxDist, start, end, &cache->hits[0], regionCasts );
+			
+		}else{
+			
+			//neighbouring columns are cast together as a packet
+			for( int p = start; p < end; p += RAY_PACKET ){
+				
+				int count = end - p < RAY_PACKET ? end - p : RAY_PACKET;
+				
+				bam_t rAng[RAY_PACKET];
+				
+				//the column angles are looked up from the camera
+				for( int k = 0; k < count; k++ )
+					rAng[k] = view + (bam_t)cam->colBam[p + k];
+				
+				//the first walls the rays run into
+				cast_ray_packet( gMap, player->x, player->y, rAng, count, maxDist, opts->traversal, &cache->hits[p] );
+			}
+			
+			for( int i = start; i < end; i++ )
+				regionCasts[fovea_region( cam, opts->foveaWidth, i )]++;
 		}
 		
-		//removing fish eye effect
-		finalDist *= std::cos(rAng - player->ang);
+		for( int r = 0; r < FOVEA_REGIONS; r++ ){
+			casts += regionCasts[r];
+			regionCast[r] += regionCasts[r];
+		}
+		recast += casts;
 		
-		if( finalDist == 0.0 ){
+		for( int i = start; i < end; i++ ){
+			
+			RayHit &hit = cache->hits[i];
+			
+			//the block whose wall was hit, nothing is drawn if the ray ran out first
+			int cell = -1;
+			if( hit.hit )
+				cell = hit.isVertical ? gMap->vert_wall_cell( hit.mapY, hit.mapX )
+										: gMap->horiz_wall_cell( hit.mapY, hit.mapX );
+			
+			hits.cell[i] = cell;
+			hits.material[i] = cell >= 0 ? gMap->cell_material( cell ) : 0;
+			
+			//the horiz offset at which a slice of the wall texture is to be picked
+			hits.offset[i] = hit.offset;
+			hits.side[i] = hit.isVertical;
+			
+			//removing fish eye effect
+			hits.dist[i] = hit.dist*cam->colCos[i];
+		}
+	});
+	
+	cache->valid = true;
+	cache->x = player->x; cache->y = player->y; cache->ang = view;
+	cache->gMap = gMap;
+	cache->maxDist = maxDist;
+	cache->traversal = opts->traversal;
+	cache->wid = cam->wid;
+	cache->spread = cam->spread;
+	
+	cache->approximate = foveated;
+	
+	cache->cast = recast.load();
+	cache->reused = reuse ? rayCount - cache->cast : 0;
+	
+	for( int r = 0; r < FOVEA_REGIONS; r++ ){
+		cache->regionColumns[r] = 0;
+		cache->regionCast[r] = regionCast[r].load();
+	}
+	for( int i = 0; i < rayCount; i++ )
+		cache->regionColumns[fovea_region( cam, opts->foveaWidth, i )]++;
+	
+	//second pass: drawing, always on the main thread since the renderer isn't thread safe
+	//the columns are sorted by the kind of their material first, so that every kind is drawn
+	//by its own kernel in one go, instead of going through the blocks column by column
+	for( int k = 0; k < MATERIAL_KINDS; k++ )
+		cache->kindColumns[k].clear();
+	
+	for( int i = 0; i < rayCount; ){
+		
+		if( hits.dist[i] == 0.0 || hits.cell[i] < 0 ){
 			//skip drawing this ray
+			i++;
 			continue;
 		}
 		
-		rayHig = ( (double)BLOCK_DIM * screenDist )/finalDist;
+		const Material &m = gMap->material( hits.material[i] );
 		
-		//if slice height is lesser than screen height, texture doesn't get clipped
-		//but if slice height is greater than, then the texture has to be clipped
-		//from above and below to coincide with the field of view of the player
-		int offset_y = 0;
+		//neighbouring columns on the same wall face go out as one trapezoid
+		if( opts->backend == RENDER_GEOMETRY ){
+			WallSpan span;
+			int end = span_end( hits, cam, fadeDist, i, &span );
+			if( end > i + 1 ){
+				batch_wall_span( batch, m, &span, hits.side[i] );
+				i = end;
+				continue;
+			}
+		}
+		
+		cache->kindColumns[m.kind].push_back( i );
+		i++;
+	}
+	
+	WallDraw draw;
+	draw.renderer = renderer; draw.frame = frame; draw.batch = batch;
+	draw.colormap = colormap; draw.textures = &gMap->wall_textures();
+	draw.backend = opts->backend;
+	
+	draw_wall_columns<MATERIAL_COLOR>( draw, gMap, hits, cache->kindColumns[MATERIAL_COLOR],
+									cam, opts, maxDist, fadeDist, fogDist );
+	draw_wall_columns<MATERIAL_TEXTURE>( draw, gMap, hits, cache->kindColumns[MATERIAL_TEXTURE],
+									cam, opts, maxDist, fadeDist, fogDist );
+	
+	//every block a ray ran into shows up on the 2D map
+	gMap->mark_seen( hits.cell.data(), rayCount );
+	
+	//every wall column of the frame in one draw call
+	if( opts->backend == RENDER_GEOMETRY )
+		batch->flush( renderer );
+}
+
+//if a hit lies close enough to the end of its wall line for the rounding of cast_ray_fixed to move it past
+static bool near_corner( double posX, double posY, bam_t rAng, RayHit *hit ){
+	
+	//position of the hit along the wall line
+	double along = hit->isVertical ? posY - bam_sin( rAng )*hit->dist : posX + bam_cos( rAng )*hit->dist;
+	double inBlock = along - std::floor( along/(double)BLOCK_DIM )*(double)BLOCK_DIM;
+	
+	//the grid lines of the hit's kind the ray stepped over before reaching it
+	int first;
+	if( hit->isVertical )
+		first = bam_cos( rAng ) > 0 ? ( (int)posX >> TILESHIFT ) + 1 : (int)posX >> TILESHIFT;
+	else
+		first = -bam_sin( rAng ) > 0 ? ( (int)posY >> TILESHIFT ) + 1 : (int)posY >> TILESHIFT;
+	int crossed = std::abs( ( hit->isVertical ? hit->mapX : hit->mapY ) - first );
+	
+	double tolerance = ( crossed + 1 )*FIXED_ROUNDING;
+	return inBlock < tolerance || (double)BLOCK_DIM - inBlock < tolerance;
+}
+
+int compare_fixed_traversal( const char *const *levels, int level_cnt, int ray_cnt ){
+	
+	//same rays on every run
+	std::mt19937 rng( 1 );
+	std::uniform_real_distribution<double> unit( 0.0, 1.0 );
+	
+	int total_mismatches = 0;
+	
+	for( int l = 0; l < level_cnt; l++ ){
 		
-		if( rayHig > hig ){
-			offset_y = (int)(((rayHig - (double)hig)*(double)BLOCK_DIM)/(2.0*rayHig));
+		SDL_Surface *mapImg = SDL_LoadBMP( levels[l] );
+		if( mapImg == NULL ){
+			std::printf( "%s couldnt be loaded. Error: %s\n", levels[l], SDL_GetError() );
+			total_mismatches++;
+			continue;
 		}
 		
-		//capping ray height at screen height
-		rayHig = rayHig > hig ? (double)hig : rayHig;
+		//only the solid bits are needed, so the walls get no textures
+		WallTextures textures = {};
+		GameMap gMap( mapImg, &textures, NULL, 0.75 );
+		SDL_FreeSurface( mapImg );
 		
-		SDL_Rect slice;
-		slice.y = (hig - (int)rayHig) >> 1; slice.x = i;
-		slice.h = (int)rayHig; slice.w = 1;
+		int rays = 0, mismatches = 0, corners = 0, offsets = 0;
 		
-		wall->blit_wall_to_screen( renderer, &slice, offset_x, offset_y, isVertical );
+		//axis parallel rays from the corners and edge middles of every empty block first, they run along
+		//grid lines or cross them exactly, then the random ones
+		int aligned = 0, random = 0;
+		int aligned_cnt = gMap.map_width()*gMap.map_height()*4*4;
+		
+		while( aligned < aligned_cnt || random < ray_cnt ){
+			
+			double posX, posY;
+			bam_t rAng;
+			bool is_random = aligned >= aligned_cnt;
+			if( !is_random ){
+				int block = aligned >> 4, spot = ( aligned >> 2 ) & 3;
+				rAng = ( aligned & 3 )*BAM_QUARTER;
+				aligned++;
+				posX = (double)( ( block % gMap.map_width() ) << TILESHIFT ) + ( spot & 1 )*( BLOCK_DIM >> 1 );
+				posY = (double)( ( block/gMap.map_width() ) << TILESHIFT ) + ( spot >> 1 )*( BLOCK_DIM >> 1 );
+			}else{
+				//random starting points, looking anywhere, with an unbounded draw distance
+				posX = unit( rng )*( gMap.map_width() << TILESHIFT );
+				posY = unit( rng )*( gMap.map_height() << TILESHIFT );
+				rAng = (bam_t)rng();
+			}
+			//only from empty blocks
+			if( gMap.solid_block_at( (int)posY >> TILESHIFT, (int)posX >> TILESHIFT ) )
+				continue;
+			if( is_random )
+				random++;
+			
+			RayHit floatHit, fixedHit;
+			cast_ray( &gMap, posX, posY, rAng, HUGE_VAL, &floatHit );
+			cast_ray_fixed( &gMap, posX, posY, rAng, HUGE_VAL, &fixedHit );
+			rays++;
+			
+			if( floatHit.hit != fixedHit.hit || floatHit.isVertical != fixedHit.isVertical
+				|| floatHit.mapX != fixedHit.mapX || floatHit.mapY != fixedHit.mapY ){
+				
+				//a ray grazing a block corner may go either way from rounding, those are only counted
+				if( near_corner( posX, posY, rAng, &floatHit ) || near_corner( posX, posY, rAng, &fixedHit ) ){
+					corners++;
+					continue;
+				}
+				
+				if( mismatches < 5 )
+					std::printf( "  mismatch at (%f, %f) angle %f: float hit line %d %d, fixed hit line %d %d\n",
+								posX, posY, bam_to_rad( rAng ), floatHit.mapX, floatHit.mapY, fixedHit.mapX, fixedHit.mapY );
+				mismatches++;
+			}else if( floatHit.offset != fixedHit.offset )
+				offsets++;
+		}
 		
+		//texture offsets may be one texel apart from rounding, that's only counted too
+		std::printf( "%s: %d rays, %d hit cell mismatches, %d corner grazes, %d texture offsets differ\n",
+					levels[l], rays, mismatches, corners, offsets );
+		total_mismatches += mismatches;
 	}
-}
\ No newline at end of file
+	
+	return total_mismatches;
+}
+
+//times fn over every sample, in nanoseconds per call
+template<typename F>
+static double time_per_call( int samples, double *sink, F fn ){
+	auto start = std::chrono::steady_clock::now();
+	double sum = 0.0;
+	for( int i = 0; i < samples; i++ )
+		sum += fn( i );
+	std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+	//keeps the loop from being optimized away
+	*sink += sum;
+	return took.count()/samples;
+}
+
+void bench_trig( int samples ){
+	
+	std::mt19937 rng( 1 );
+	std::uniform_real_distribution<double> coord( -1000.0, 1000.0 );
+	
+	std::vector<bam_t> bams( samples );
+	std::vector<double> rads( samples ), xs( samples ), ys( samples );
+	for( int i = 0; i < samples; i++ ){
+		bams[i] = (bam_t)rng();
+		rads[i] = bam_to_rad( bams[i] );
+		xs[i] = coord( rng );
+		ys[i] = coord( rng );
+	}
+	
+	//largest error of each approximation against the standard library
+	double sinErr = 0.0, nearestErr = 0.0, tanErr = 0.0, atanErr = 0.0;
+	for( int i = 0; i < samples; i++ ){
+		double exact = std::sin( rads[i] );
+		sinErr = std::max( sinErr, std::fabs( bam_sin( bams[i] ) - exact ) );
+		nearestErr = std::max( nearestErr, std::fabs( sinTable[( bams[i] + ( 1u << ( SIN_FRAC_BITS - 1 ) ) ) >> SIN_FRAC_BITS] - exact ) );
+		//tan is compared away from its poles, where any error blows up
+		if( std::fabs( std::cos( rads[i] ) ) > 0.1 )
+			tanErr = std::max( tanErr, std::fabs( bam_tan( bams[i] ) - std::tan( rads[i] ) ) );
+		double ang = std::atan2( ys[i], xs[i] );
+		atanErr = std::max( atanErr, std::fabs( bam_to_signed_rad( bam_atan2( ys[i], xs[i] ) - rad_to_bam( ang ) ) ) );
+	}
+	
+	double sink = 0.0;
+	
+	double stdSin = time_per_call( samples, &sink, [&]( int i ){ return std::sin( rads[i] ); } );
+	double lutSin = time_per_call( samples, &sink, [&]( int i ){ return bam_sin( bams[i] ); } );
+	double nearestSin = time_per_call( samples, &sink, [&]( int i ){
+		return sinTable[( bams[i] + ( 1u << ( SIN_FRAC_BITS - 1 ) ) ) >> SIN_FRAC_BITS]; } );
+	double stdTan = time_per_call( samples, &sink, [&]( int i ){ return std::tan( rads[i] ); } );
+	double lutTan = time_per_call( samples, &sink, [&]( int i ){ return bam_tan( bams[i] ); } );
+	double stdAtan = time_per_call( samples, &sink, [&]( int i ){ return std::atan2( ys[i], xs[i] ); } );
+	double lutAtan = time_per_call( samples, &sink, [&]( int i ){ return (double)bam_atan2( ys[i], xs[i] ); } );
+	//wrapping the sum of two angles, as done for every column and turn
+	double stdWrap = time_per_call( samples, &sink, [&]( int i ){
+		return modPI( mod2PI( rads[i] - rads[samples - 1 - i] ) ); } );
+	double bamWrap = time_per_call( samples, &sink, [&]( int i ){
+		return (double)(Sint32)( bams[i] - bams[samples - 1 - i] ); } );
+	
+	std::printf( "%d samples, sin table of %d entries, atan table of %d entries\n",
+				samples, SIN_TABLE_SIZE, ATAN_TABLE_SIZE );
+	std::printf( "             float      table     max error\n" );
+	std::printf( "sin        %6.2f ns  %6.2f ns  %.2e\n", stdSin, lutSin, sinErr );
+	std::printf( "sin nearest           %6.2f ns  %.2e\n", nearestSin, nearestErr );
+	std::printf( "tan        %6.2f ns  %6.2f ns  %.2e\n", stdTan, lutTan, tanErr );
+	std::printf( "atan2      %6.2f ns  %6.2f ns  %.2e rad\n", stdAtan, lutAtan, atanErr );
+	std::printf( "wrap       %6.2f ns  %6.2f ns\n", stdWrap, bamWrap );
+	std::printf( "(checksum %g)\n", sink );
+}
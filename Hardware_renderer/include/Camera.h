@@ -0,0 +1,35 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <vector>
+#include "trig.h"
+
+	//projection of the player's view onto the screen
+	//everything in here depends only on the screen size and the field of view, not on the player
+	class Camera{
+		public:
+			//dimensions of the screen
+			int wid, hig;
+			
+			//half of the field of view, in radians
+			double spread;
+			
+			//distance away from the player where the "screen" is situated.
+			//all rays are projected onto this screen
+			double screenDist;
+			
+			//angle of each screen column from the player's view direction, in (-pi, pi)
+			std::vector<double> colAng;
+			//the same angles as signed binary angles, columns further right have smaller ones
+			std::vector<Sint32> colBam;
+			//cosine of those angles, for removing the fish eye effect
+			std::vector<double> colCos;
+			
+			Camera();
+			
+			//rebuilds the tables if the screen size or the field of view changed
+			//returns true if they had to be rebuilt
+			bool update( int wid_, int hig_, double spread_ );
+	};
+
+#endif
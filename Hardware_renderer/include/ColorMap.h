@@ -0,0 +1,49 @@
+#ifndef COLOR_MAP_H
+#define COLOR_MAP_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "FrameBuffer.h"
+
+	//a mip chain of 8-bit indexed images, every level transposed like MipChain
+	struct IndexedMips{
+		IndexedImage levels[MIP_LEVELS];
+	};
+	
+	//a palette of up to 256 colors, and a table of every palette color at every light level
+	//walls are kept as palette indices only once, the dark sides and the distance fog
+	//are a different row of the table instead of another copy of the textures
+	class ColorMap{
+		private:
+			//each row is 256 colors long, the bright rows first and then the dark ones
+			std::vector<Uint32> table;
+			
+			//index of the palette color closest to color
+			int nearest( Uint32 color );
+		
+		public:
+			std::vector<Uint32> palette;
+			
+			//number of steps from no fog to full fog, for each side
+			int lightLevels;
+			
+			ColorMap();
+			
+			//builds the palette out of the colors used most in mips, leaving spare entries for add_color,
+			//and turns every level into palette indices
+			void index_mips( const MipChain *mips, IndexedMips *indexed );
+			
+			//index of color in the palette, added if there's still room, the closest one otherwise
+			Uint8 add_color( Uint32 color );
+			
+			//fills the table once the palette is done. The dark rows are scaled by darkRatio,
+			//and row lightLevels - 1 of either side is fogColor
+			void build_table( int lightLevels_, double darkRatio, Uint32 fogColor );
+			
+			//the row of 256 colors for a side and a fog level from 0 up to lightLevels - 1
+			const Uint32 *shade( bool dark, int level ) const {
+				return &table[( ( dark ? lightLevels : 0 ) + level ) << 8];
+			}
+	};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef COLUMN_SCALER_H
+#define COLUMN_SCALER_H
+
+#include <SDL2/SDL.h>
+#include <initializer_list>
+#include <utility>
+
+	//columns up to this many pixels tall are drawn by a scaler made for their exact height
+	//with the loop taken out, like the scalers the old games compiled for every wall height
+	//taller ones go through the loop, SCALER_CHUNK pixels per trip
+	const int SCALER_UNROLLED = 64;
+	const int SCALER_CHUNK = 8;
+
+	//where the scalers get their colors from, texel is the index of the texel in the column
+	//plain colors, from a transposed image
+	struct DirectTexels{
+		const Uint32 *src;
+		inline Uint32 operator()( Uint32 texel ) const { return src[texel]; }
+	};
+	//palette indices from a transposed indexed image, looked up in a row of the color map
+	struct ShadedTexels{
+		const Uint8 *src;
+		const Uint32 *shade;
+		inline Uint32 operator()( Uint32 texel ) const { return shade[src[texel]]; }
+	};
+
+	//writes one pixel for every I, pitch apart, the texel positions are 16.16 fixed point
+	//and wrap around the same way stepping them one pixel after the other would
+	template<class Texels, int... I>
+	inline void scale_pixels( Uint32 *dst, int pitch, Texels texels, Uint32 texY, Uint32 step,
+							std::integer_sequence<int, I...> ){
+		(void)std::initializer_list<int>{ ( dst[I*pitch] = texels( ( texY + (Uint32)I*step ) >> 16 ), 0 )... };
+	}
+
+	//scales texels onto exactly H pixels, texY is the texel position of the first one and step
+	//how far it moves from one pixel to the next
+	template<int H, class Texels>
+	void scale_column_fixed( Uint32 *dst, int pitch, Texels texels, Uint32 texY, Uint32 step ){
+		scale_pixels( dst, pitch, texels, texY, step, std::make_integer_sequence<int, H>() );
+	}
+
+	template<class Texels>
+	using ColumnScaler = void (*)( Uint32 *dst, int pitch, Texels texels, Uint32 texY, Uint32 step );
+
+	//the scalers for the heights 1 up to SCALER_UNROLLED, the one for height h is at h - 1
+	template<class Texels, int... H>
+	const ColumnScaler<Texels> *scaler_table( std::integer_sequence<int, H...> ){
+		static const ColumnScaler<Texels> table[] = { &scale_column_fixed<H + 1, Texels>... };
+		return table;
+	}
+
+	//scales texels onto count pixels, pitch apart, picking the scaler made for that height if there is one
+	template<class Texels>
+	void scale_column( Uint32 *dst, int pitch, int count, Texels texels, Uint32 texY, Uint32 step ){
+
+		static const ColumnScaler<Texels> *table =
+			scaler_table<Texels>( std::make_integer_sequence<int, SCALER_UNROLLED>() );
+
+		if( count <= 0 )
+			return;
+
+		//the generic one, whole chunks first and then whatever is left with the fixed scaler for it
+		while( count > SCALER_UNROLLED ){
+			scale_column_fixed<SCALER_CHUNK>( dst, pitch, texels, texY, step );
+			dst += SCALER_CHUNK*pitch;
+			texY += SCALER_CHUNK*step;
+			count -= SCALER_CHUNK;
+		}
+
+		table[count - 1]( dst, pitch, texels, texY, step );
+	}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef FLOOR_CASTER_H
+#define FLOOR_CASTER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "FrameBuffer.h"
+#include "ColorMap.h"
+#include "Camera.h"
+#include "custom_math.h"
+
+	//side of the floor and ceiling textures, one texture covers one block of the map
+	const int FLOOR_DIM = 64;
+	
+	//a floor row and the ceiling row mirroring it, both lie at the same distance
+	struct FloorRow{
+		//map position under the first pixel and the step from one pixel to the next, in 16.16 fixed point
+		//only the low bits pick the texel, so these are free to wrap around
+		Uint32 fx, fy, dfx, dfy;
+		//the floor row and the ceiling row
+		int y, yc;
+		//color map row for the fog at this distance, NULL for plain colors
+		const Uint32 *shade;
+	};
+	
+	//draws textured floors and ceilings into the software frame buffer, one screen row at a time
+	//every row lies at one distance, so the map position under its pixels steps by a constant amount
+	//and is kept in fixed point, 8 pixels at a time with AVX2 where the CPU has it
+	//only the pixels above and below the walls castRays drew are written
+	class FloorCaster{
+		private:
+			//the textures, FLOOR_DIM texels a row, row after row, as colors and as palette indices
+			//the indexed ones are padded so that 4 bytes can always be read from any texel
+			std::vector<Uint32> floorPixels, ceilingPixels;
+			std::vector<Uint8> floorIndexed, ceilingIndexed;
+			
+			//first and one past the last row of the wall in every column
+			std::vector<int> wallTop, wallBottom;
+			//every floor row of the frame, set up before any of them is cast
+			std::vector<FloorRow> rows;
+		
+		public:
+			//cuts the floor and ceiling textures out of the strip of wall textures,
+			//wall_indexed has to be the same strip as palette indices
+			void load_textures( const PixelImage *wall_pixels, const IndexedMips *wall_indexed,
+								int floorTexture, int ceilingTexture );
+			
+			//draws the floor and the ceiling of the view from (posX, posY) looking at ang, around the walls
+			//in hits. colormap is NULL for plain colors, otherwise the fog is fully in at fogDist
+			void draw( FrameBuffer *frame, double posX, double posY, double ang, Camera *cam,
+					const HitBuffer &hits, const ColorMap *colormap, double fogDist );
+	};
+	
+	//runtime check for the AVX2 row kernel
+	bool floor_simd_supported();
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+	//an image kept in memory as 32-bit ARGB pixels, row after row, instead of as an SDL_Texture
+	struct PixelImage{
+		int wid, hig;
+		std::vector<Uint32> pixels;
+	};
+	
+	//an image kept as 8-bit indices into a palette, laid out like PixelImage
+	struct IndexedImage{
+		int wid, hig;
+		std::vector<Uint8> pixels;
+	};
+	
+	//copies any surface into image, converting it to ARGB, returns false if the conversion failed
+	bool load_pixels( SDL_Surface *surface, PixelImage *image );
+	
+	//turns image on its side, so that every column of image is one row of columns, texel (x, y)
+	//of image ends up at columns->pixels[x*columns->wid + y]. Columns of textures are drawn top
+	//to bottom, and are read much faster when their texels lie next to each other
+	void transpose_pixels( const PixelImage *image, PixelImage *columns );
+	
+	//enough levels to take a 64 texel texture down to a single texel
+	const int MIP_LEVELS = 7;
+	
+	//an image halved in size again and again, every level box filtered from the one before it
+	//level 0 is the full image, and every level is transposed like transpose_pixels
+	struct MipChain{
+		PixelImage levels[MIP_LEVELS];
+	};
+	
+	//builds all the levels of image. For a strip of square textures side by side, a texture never
+	//bleeds into its neighbours as long as the textures are 2^(MIP_LEVELS-1) texels wide, and the
+	//last level is then the average color of every texture
+	void build_mips( const PixelImage *image, MipChain *mips );
+	
+	//runtime check for the AVX2 transpose on present
+	bool transpose_simd_supported();
+	
+	inline Uint32 pack_rgb( Uint8 r, Uint8 g, Uint8 b ){
+		return 0xFF000000u | ( (Uint32)r << 16 ) | ( (Uint32)g << 8 ) | (Uint32)b;
+	}
+	
+	//mixes src over dst, alpha of 255 is fully src
+	inline Uint32 blend_pixel( Uint32 src, Uint32 dst, Uint32 alpha ){
+		//red and blue are blended together, then green, 8 bits apart so they don't spill into each other
+		Uint32 rb = ( ( ( src & 0xFF00FFu )*alpha + ( dst & 0xFF00FFu )*( 255 - alpha ) ) >> 8 ) & 0xFF00FFu;
+		Uint32 g = ( ( ( src & 0x00FF00u )*alpha + ( dst & 0x00FF00u )*( 255 - alpha ) ) >> 8 ) & 0x00FF00u;
+		return 0xFF000000u | rb | g;
+	}
+	
+	//the whole 3D view is drawn into pixels on the CPU, and uploaded to the screen once per frame
+	//through a streaming texture, instead of one draw call per column
+	//the pixels are either kept row after row, like the texture, or column after column, so that
+	//the wall and sprite columns are written to memory that lies together. They are then turned
+	//the right way round while being uploaded
+	class FrameBuffer{
+		private:
+			SDL_Texture *texture;
+			
+			//copies the column major pixels into the texture's rows
+			void transpose_to( Uint32 *dst, int dstPitch );
+		
+		public:
+			int wid, hig;
+			std::vector<Uint32> pixels;
+			
+			//true if the pixels are kept column after column
+			bool columnMajor;
+			//pixel (x, y) is at pixels[x*pitchX + y*pitchY]
+			int pitchX, pitchY;
+			
+			//time present took to turn the pixels round, and to upload them, in seconds, summed over
+			//the presents since the layout or the size last changed. Drawing the texture isn't in either
+			double transposeTime, uploadTime;
+			int presents;
+			
+			FrameBuffer();
+			~FrameBuffer();
+			
+			//recreates the buffer and the texture if the size changed, returns false if the texture couldn't be made
+			bool resize( SDL_Renderer *renderer, int wid_, int hig_ );
+			
+			//switches between keeping the pixels row after row and column after column
+			//what's in the buffer is lost, it's meant to be switched between frames
+			void set_layout( bool columnMajor_ );
+			
+			//fills the rows from y0 up to y1 with one color, for the sky and the ground
+			void fill_rows( int y0, int y1, Uint32 color );
+			
+			//fills part of a column with one color, blending it in if alpha isn't 255
+			void fill_column( int x, int y, int h, Uint32 color, Uint8 alpha );
+			
+			//scales the srcH texels of an image below (srcX, srcY) onto h pixels of column x, starting at y
+			//the image is given transposed, as made by transpose_pixels, so texel column srcX is row srcX of columns
+			//parts outside the buffer are clipped, alpha blends it in like fill_column
+			//opaque columns go through the scalers in ColumnScaler.h, here and in draw_indexed_column
+			void draw_column( int x, int y, int h, const PixelImage *columns, int srcX, int srcY, int srcH, Uint8 alpha );
+			
+			//same as draw_column for a transposed indexed image, every texel is looked up in shade,
+			//a row of 256 colors that already has the lighting of this column in it
+			void draw_indexed_column( int x, int y, int h, const IndexedImage *columns, int srcX, int srcY, int srcH,
+									const Uint32 *shade, Uint8 alpha );
+			
+			//uploads the pixels and copies them onto the whole render target
+			//column major pixels are transposed into the texture on the way, 8x8 pixels at a time with AVX2
+			void present( SDL_Renderer *renderer );
+	};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <SDL2/SDL.h>
 #include "blocks.h"
+#include "Camera.h"
+#include "MapPyramid.h"
+#include <vector>
 
 class GameMap{
 	private:
@@ -18,9 +21,44 @@ class GameMap{
 		//Number of horiz and vertical walls
 		int H_WALL_CNT, V_WALL_CNT;
 		
+		//index of the block every vert and horiz wall belongs to, -1 for empty walls
+		std::vector<int> vLineCells, hLineCells;
+		
+		//the looks of the walls, and which one every block has
+		std::vector<Material> materials;
+		std::vector<Uint16> cellMaterials;
+		WallTextures wallTextures;
+		
+		//index of the material that looks like m, which is added if there's none yet
+		Uint16 find_material( const Material &m );
+		
+		//dense bitsets of the solid blocks, vert walls and horiz walls, for ray traversal
+		//each one is padded by a border of solid bits one block wide, so rays never leave them
+		std::vector<Uint32> blockBits, vLineBits, hLineBits;
+		//width of a padded row in bits
+		int blockStride, vLineStride, hLineStride;
+		
+		//Chebyshev distance (in blocks) from every block to the nearest solid block, same padding as blockBits
+		//a value of d means every block less than d blocks away in x and y is empty
+		std::vector<Uint8> freeDist;
+		
+		//fills the bitsets from the block arrays
+		void build_occupancy();
+		//fills freeDist from the block bitset
+		void build_distance_field();
+		
+		static inline bool test_bit( const std::vector<Uint32> &bits, int stride, int y, int x ){
+			int i = ( y + 1 )*stride + x + 1;
+			return ( bits[i >> 5] >> ( i & 31 ) ) & 1;
+		}
+		
 		//MapObject player;
 		
+		//zoom level of the top down view, one of the MAP_LEVELS of the map pyramid
 		int mapZoom;
+		
+		//indices of the blocks that were seen since the top down view was last drawn
+		std::vector<int> newlySeen;
 	
 	public:
 		//Width of a wall
@@ -28,7 +66,9 @@ class GameMap{
 		const unsigned TILESHIFT = 6;
 		
 		//creates the game map by using the game map image
-		GameMap(SDL_Surface *mapImg, SDL_Texture *wall_textures, SDL_Texture *dark_wall_textures, double wallColorRatio);
+		//textures holds the wall textures in every form the rendering backends draw from
+		//the colors of plain colored walls are added to colormap, whose palette textures->indexed uses
+		GameMap(SDL_Surface *mapImg, const WallTextures *textures, ColorMap *colormap, double wallColorRatio);
 		
 		//prints the map to the console
 		void printMap();
@@ -42,7 +82,49 @@ class GameMap{
 		bool solid_horiz_wall_at( int x, int y );
 		bool solid_vert_wall_at( int x, int y );
 		
-		void draw2DMap(SDL_Renderer *renderer, int posX, int posY);
+		//unchecked versions for the ray traversal loops
+		//valid up to one block outside the map, where everything is solid
+		inline bool solid_block_bit( int y, int x ) const {
+			return test_bit( blockBits, blockStride, y, x );
+		}
+		inline bool solid_horiz_wall_bit( int y, int x ) const {
+			return test_bit( hLineBits, hLineStride, y, x );
+		}
+		inline bool solid_vert_wall_bit( int y, int x ) const {
+			return test_bit( vLineBits, vLineStride, y, x );
+		}
+		//distance to the nearest solid block, 0 for solid blocks, also unchecked
+		inline int free_dist( int y, int x ) const {
+			return freeDist[( y + 1 )*blockStride + x + 1];
+		}
+		
+		//size of the map in blocks
+		inline int map_height() const { return mapDims[0]; }
+		inline int map_width() const { return mapDims[1]; }
+		
+		//index of the block a vert or horiz wall belongs to, -1 if the wall is empty or outside the map
+		//blocks are indexed row after row, like block_at
+		int vert_wall_cell( int y, int x ) const;
+		int horiz_wall_cell( int y, int x ) const;
+		
+		//the look of the block at a cell index, as an index into the materials
+		inline Uint16 cell_material( int cell ) const { return cellMaterials[cell]; }
+		inline const Material &material( int id ) const { return materials[id]; }
+		inline const WallTextures &wall_textures() const { return wallTextures; }
+		
+		//marks the blocks at count cell indices as seen on the 2D map, cells below 0 are skipped
+		void mark_seen( const int *cells, int count );
+		
+		//marks every seen block to be drawn into the map pyramid again, for when it lost its pages
+		void redraw_seen();
+		
+		//zooms the top down view out by steps levels, in if steps is negative
+		void zoom_2d_map( int steps );
+		inline int map_zoom() const { return mapZoom; }
+		
+		//draws the top down view centered at posX, posY, by bringing pyramid up to date and copying from it
+		//without a pyramid every block on the screen is drawn on its own
+		void draw2DMap(SDL_Renderer *renderer, Camera *cam, MapPyramid *pyramid, int posX, int posY);
 };
 
 #endif
\ No newline at end of file
@@ -27,8 +27,8 @@
 			//only applicable to enemies
 			virtual bool follow_player(GameMap *gmap, std::vector<MapObject*> &agent_arr, double dt) = 0;
 			
-			//draw 2D sprite on the top-down view screen
-			virtual void sprite2D(SDL_Renderer *renderer) = 0;
+			//draw 2D sprite on the top-down view screen, at the zoom level of the map
+			virtual void sprite2D(SDL_Renderer *renderer, Camera *cam, int zoom) = 0;
 			
 			virtual void double_speed() = 0;
 	};
@@ -41,7 +41,7 @@
 			Player();
 			
 			//draws the player at the center of the top-down view screen
-			void sprite2D( SDL_Renderer *renderer );
+			void sprite2D( SDL_Renderer *renderer, Camera *cam, int zoom );
 			
 			//does nothing, returns false
 			bool follow_player(GameMap *gmap, std::vector<MapObject*> &agent_arr, double dt);
@@ -67,11 +67,13 @@
 		
 			//the sprite of the agent
 			SDL_Texture *spriteText;
+			//the same sprite as transposed pixels, for the software frame buffer
+			const PixelImage *spriteColumns;
 			
 			//the x and y diffs between enemy and player (from enemy's POV) and the full distance
 			double diffX_player, diffY_player, diff_hypot;
 			
-			Agent(SDL_Texture *sprite, double posX, double posY, double ang_, int objDim_,
+			Agent(SDL_Texture *sprite, const PixelImage *spriteColumns_, double posX, double posY, double ang_, int objDim_,
 				int tile_radius_, double speed_, double angVel_ );
 			
 			//this is implemented properly
@@ -83,7 +85,7 @@
 			void reset_to_idle();
 			
 			//display agent sprite on the 2D top down view iff agent has seen the player
-			void sprite2D(SDL_Renderer *renderer);
+			void sprite2D(SDL_Renderer *renderer, Camera *cam, int zoom);
 			
 			void double_speed();
 	};
@@ -95,6 +97,10 @@
 	};
 	
 	//to place enemies into a priority queue and draw them on the screen starting from the farthest away from player to nearest
-	void draw_3D_sprites( SDL_Renderer *renderer, GameMap *gMap, MapObject *player, std::vector<MapObject*> &agent_arr, double spread );
+	//hits holds the per-column wall depths castRays filled for this frame
+	//agents farther away than maxDist are not drawn
+	//sprites are drawn into frame if it isn't NULL, and onto the renderer if it is
+	void draw_3D_sprites( SDL_Renderer *renderer, FrameBuffer *frame, MapObject *player, std::vector<MapObject*> &agent_arr,
+						Camera *cam, const HitBuffer &hits, double maxDist );
 	
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef MAP_PYRAMID_H
+#define MAP_PYRAMID_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+class GameMap;
+
+	//zoom levels of the top down view, a block is MAP_BLOCK_PIXELS wide at level 0
+	//and half as wide at every level after it
+	const int MAP_LEVELS = 4;
+	const int MAP_BLOCK_PIXELS = 32;
+	//largest side of a page texture, smaller if the renderer can't make textures this big
+	const int MAP_PAGE_DIM = 2048;
+	
+	//the explored map, kept drawn in textures at every zoom level
+	//every level is cut into square pages, which are only made once a block on them has been seen,
+	//so the top down view is a copy from the one to four pages under the screen
+	class MapPyramid{
+		private:
+			//side of a page in pixels, same at every level, always a power of 2
+			int pageDim;
+			//size of the map in blocks
+			int mapWid, mapHig;
+			
+			//the pages of every level, row after row, NULL for the ones with nothing seen on them yet
+			std::vector<SDL_Texture*> pages[MAP_LEVELS];
+			//number of pages in a row of every level
+			int pagesX[MAP_LEVELS];
+			
+			//the page of a level that has the block x, y on it, made if it's not there yet
+			SDL_Texture *page_at( SDL_Renderer *renderer, int level, int x, int y );
+		
+		public:
+			MapPyramid();
+			~MapPyramid();
+			
+			//sets up the levels for a map of mapWid_ by mapHig_ blocks
+			//returns false if the renderer can't draw into textures, the top down view has to go block by block then
+			bool create( SDL_Renderer *renderer, int mapWid_, int mapHig_ );
+			
+			//drops every page, for when the renderer lost what was drawn into them
+			void release();
+			
+			//draws the blocks at the given cell indices into every level, the renderer draws to the screen again after
+			void update( SDL_Renderer *renderer, GameMap *gmap, const std::vector<int> &cells );
+			
+			//copies the part of a level under the screen, viewX, viewY is where the top left corner of the screen
+			//lies on the level in pixels
+			void draw( SDL_Renderer *renderer, int level, int viewX, int viewY, int wid, int hig );
+	};
+
+#endif
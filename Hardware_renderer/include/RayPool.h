@@ -0,0 +1,47 @@
+#ifndef RAY_POOL_H
+#define RAY_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+	//persistent pool of worker threads for casting the screen in column strips
+	class RayPool{
+		private:
+			std::vector<std::thread> workers;
+			
+			std::mutex lock;
+			//wakes the workers up when a new job is posted, and the caller when all strips are done
+			std::condition_variable wake, done;
+			
+			//the job being run, called with the first and one-past-last column of a strip
+			const std::function<void(int, int)> *job;
+			int jobCount;
+			
+			//incremented for every job so that workers don't run the same job twice
+			unsigned generation;
+			//number of workers still busy with the current job
+			int pending;
+			bool quit;
+			
+			void worker_loop( int index );
+			
+			//bounds of the strip given to a thread
+			void strip_bounds( int index, int *start, int *end );
+		
+		public:
+			//thread_cnt of 0 uses all cores, 1 casts everything on the calling thread
+			RayPool( int thread_cnt );
+			~RayPool();
+			
+			//total threads casting, including the calling thread
+			int thread_count();
+			
+			//splits [0, count) into one strip per thread and runs the job on each of them
+			//returns once every strip has been finished
+			void run( int count, const std::function<void(int, int)> &job_ );
+	};
+
+#endif
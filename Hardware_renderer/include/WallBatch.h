@@ -0,0 +1,65 @@
+#ifndef WALL_BATCH_H
+#define WALL_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "FrameBuffer.h"
+
+	//a run of neighbouring columns showing the same wall face, drawn as one trapezoid
+	struct WallSpan{
+		//left and right screen edges
+		float x0, x1;
+		//top and bottom of the wall at both edges, not clipped to the screen
+		float top0, bottom0, top1, bottom1;
+		//horiz texel offsets into the wall texture at both edges
+		float u0, u1;
+	};
+	
+	//gathers every wall column of a frame into one vertex and index buffer,
+	//so that the walls go out to the renderer in a single SDL_RenderGeometry call
+	class WallBatch{
+		private:
+			//the wall texture atlas, with a white strip on the right for the plain colored walls
+			SDL_Texture *atlas;
+			int atlasWid, atlasHig;
+			
+			std::vector<SDL_Vertex> vertices;
+			std::vector<int> indices;
+			
+			//adds the trapezoid of span, with the texels from (u0, v0) to (u1, v1) in atlas pixels
+			//and one color for all corners
+			void add_trapezoid( const WallSpan *span, float u0, float v0, float u1, float v1, SDL_Color color );
+		
+		public:
+			//shade the dark sides of walls are multiplied with, instead of having dark textures of their own
+			Uint8 darkShade;
+			
+			WallBatch();
+			~WallBatch();
+			
+			//builds the atlas texture from the wall textures, returns false if it couldn't be created
+			bool load_atlas( SDL_Renderer *renderer, const PixelImage *wall_pixels, double wallColorRatio );
+			
+			//forgets the quads of the last frame
+			void clear();
+			
+			//a textured wall column, srcX, srcY and srcH pick the texels from the atlas like for SDL_RenderCopy
+			void add_textured_column( SDL_Rect *dstRect, int srcX, int srcY, int srcH, bool dark, Uint8 alpha );
+			
+			//a plain colored wall column
+			void add_color_column( SDL_Rect *dstRect, Uint8 r, Uint8 g, Uint8 b, Uint8 alpha );
+			
+			//a whole span of a textured wall, srcX is where the wall's texture starts in the atlas
+			void add_textured_span( const WallSpan *span, int srcX, bool dark, Uint8 alpha );
+			
+			//a whole span of a plain colored wall
+			void add_color_span( const WallSpan *span, Uint8 r, Uint8 g, Uint8 b, Uint8 alpha );
+			
+			//primitives drawn by the last flush
+			int lastQuads;
+			
+			//draws all the quads at once
+			void flush( SDL_Renderer *renderer );
+	};
+
+#endif
@@ -2,6 +2,33 @@
 #define BLOCKS_H
 
 #include <SDL2/SDL.h>
+#include "FrameBuffer.h"
+#include "ColorMap.h"
+
+	//kinds of wall looks, the 3D view draws the walls of every kind with a kernel of its own
+	enum MaterialKind{
+		MATERIAL_COLOR,		//one plain color
+		MATERIAL_TEXTURE,	//one of the wall textures
+		MATERIAL_KINDS
+	};
+	
+	//how a wall looks, every wall block of the map has one, and blocks that look alike share it
+	struct Material{
+		MaterialKind kind;
+		//plain colored walls: the color, the darker one for vert walls, and where the color is in the palette
+		Uint8 colors[3], dark_colors[3];
+		Uint8 paletteIndex;
+		//textured walls: the horiz texel where the texture starts in the strip of wall textures
+		int textureOffset;
+	};
+	
+	//the strip of wall textures every textured material is cut from, in every form the backends draw from
+	//there are no dark copies, the dark sides are tinted by darkShade or shaded through the color map
+	struct WallTextures{
+		SDL_Texture *wall;
+		Uint8 darkShade;
+		const IndexedMips *indexed;
+	};
 
 	class Block{
 		
@@ -17,24 +44,16 @@
 			//If this block is a wall
 			bool isWall;
 			
-			virtual void blit_wall_to_screen( SDL_Renderer *renderer, SDL_Rect *dstRect,
-									int offset, int offset_y, bool vert ) = 0;
-									
 			virtual void blit_wall_to_2d_screen( SDL_Renderer *renderer, SDL_Rect *dstRect ) = 0;
 	};
 
 	class ColorBlock : public Block{
 		
 		public:
-		
-			Uint8 dark_colors[3];
 			
 			//constructor for a general solid colored block
-			ColorBlock(Uint8 R_, Uint8 G_, Uint8 B_, bool isWall_, double wallColorRatio);
-			ColorBlock(double wallColorRatio);
-			
-			void blit_wall_to_screen( SDL_Renderer *renderer, SDL_Rect *dstRect,
-								int offset, int offset_y, bool vert );
+			ColorBlock(Uint8 R_, Uint8 G_, Uint8 B_, bool isWall_);
+			ColorBlock();
 			
 			void blit_wall_to_2d_screen( SDL_Renderer *renderer, SDL_Rect *dstRect );
 	};
@@ -43,14 +62,9 @@
 			
 		public:
 			
-			SDL_Texture *dark_wall_texture;
 			int texture_offset;
 			
-			TextureBlock(SDL_Texture *wall_textures, SDL_Texture *dark_wall_textures,
-						int texture_offset_ );
-			
-			void blit_wall_to_screen( SDL_Renderer *renderer, SDL_Rect *dstRect,
-									int offset, int offset_y, bool vert );
+			TextureBlock(SDL_Texture *wall_textures, int texture_offset_ );
 			
 			void blit_wall_to_2d_screen( SDL_Renderer *renderer, SDL_Rect *dstRect );
 	};
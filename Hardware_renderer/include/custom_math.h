@@ -2,14 +2,99 @@
 #define RAY_CAST_H
 
 #include "GameMap.h"
+#include "trig.h"
 #include <set>
 	
+	//everything that is known about the first wall a ray runs into
+	struct RayHit{
+		//euclidean distance from the ray origin to the hit point
+		double dist;
+		//wall line indices of the hit (same indexing as horiz_wall_at/vert_wall_at)
+		int mapX, mapY;
+		//horiz offset into the wall texture
+		int offset;
+		//true if a vertical wall line was hit
+		bool isVertical;
+		//false if the draw distance ran out before any wall was met
+		bool hit;
+	};
+	
+	//what castRays found for every column of the screen, one array per field
+	//filled by the casting pass, and read one field at a time by the passes after it
+	struct HitBuffer{
+		//index of the block whose wall was hit, -1 if there's nothing to draw in this column
+		std::vector<int> cell;
+		//1 if a vertical wall was hit
+		std::vector<Uint8> side;
+		//horiz offset into the wall texture
+		std::vector<Uint8> offset;
+		//fish eye corrected distance to the wall, sprites are clipped against this
+		std::vector<double> dist;
+		//look of the wall, as an index into the map's materials
+		std::vector<Uint16> material;
+		
+		inline int size() const { return (int)cell.size(); }
+		
+		void resize( int count ){
+			cell.resize( count ); side.resize( count ); offset.resize( count );
+			dist.resize( count ); material.resize( count );
+		}
+	};
+	
 	double real_atan(double diffX, double diffY);
 	double mod2PI( double ang );
 	double modPI( double ang );
+	
+	//rays are cast at binary angles, their directions come from the trig tables
+	
+	//single pass traversal, steps over horiz and vert grid lines in one loop
+	//and stops at the first solid wall, at the edge of the map, or once it's farther than maxDist
+	//maxDist can be HUGE_VAL for an unbounded draw distance
+	void cast_ray( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit );
+	
+	//same hits as cast_ray, but jumps over empty space using the map's distance field
+	//much faster on big open maps, a bit slower in tight mazes
+	void cast_ray_skip( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit );
+	
+	//same walk as cast_ray, but ray coordinates are kept in 16.16 fixed point, so cells and
+	//texture offsets are shifts and masks. Hit cells can differ from cast_ray by rounding, only for rays
+	//passing a block corner closer than the intercept's rounding error, which is 1/131072 of a map unit
+	//plus as much again for every grid line stepped over, under 1/500 of a unit across the biggest map
+	//maps wider or taller than FIXED_MAX_BLOCKS fall back to cast_ray
+	void cast_ray_fixed( GameMap *gMap, double posX, double posY, bam_t rAng, double maxDist, RayHit *hit );
+	
+	//biggest map, in blocks, whose coordinates fit in 16.16 fixed point
+	const int FIXED_MAX_BLOCKS = 250;
+	
+	//how rays walk through the grid
+	enum TraversalMode{
+		TRAVERSE_STEP,	//one grid line at a time
+		TRAVERSE_SKIP,	//empty space skipping
+		TRAVERSE_FIXED	//one grid line at a time, in fixed point
+	};
+	
+	//number of neighbouring rays cast together by cast_ray_packet
+	const int RAY_PACKET = 4;
+	
+	//casts up to RAY_PACKET rays from the same point at once, with SIMD if the CPU supports it
+	//and one ray after the other if it doesn't. Gives the same hits as cast_ray
+	void cast_ray_packet( GameMap *gMap, double posX, double posY, const bam_t *rAng, int count, double maxDist,
+						TraversalMode mode, RayHit *hits );
+	//runtime check for the SIMD packet caster
+	bool packet_simd_supported();
+	
+	//recomputes the distance and texture offset for a ray at rAng that hits the same wall line
+	//as the one already in hit, without walking through the grid
+	void ray_hit_on_line( double posX, double posY, bam_t rAng, RayHit *hit );
+	//same, with the texture offset rounded the way cast_ray_fixed rounds it
+	void ray_hit_on_line_fixed( GameMap *gMap, double posX, double posY, bam_t rAng, RayHit *hit );
+	
+	//reference path, casts the horiz and vert rays separately and keeps the closer one
+	void cast_ray_legacy( GameMap *gMap, double posX, double posY, double rAng, int depth, RayHit *hit );
+	
 	bool cast_vert_ray( GameMap *gMap, double posX, double posY, double rAng, int depth,
 						int *mapX, int *mapY, double *dist, int *offset );
 	bool cast_horiz_ray( GameMap *gMap, double posX, double posY, double rAng, int depth,
 						int *mapX, int *mapY, double *dist, int *offset );
 
-#endif
\ No newline at end of file
+#endif
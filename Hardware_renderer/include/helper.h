@@ -2,14 +2,123 @@
 #define HELPER_H
 #include "GameMap.h"
 #include "MapObject.h"
+#include "RayPool.h"
+#include "Camera.h"
+#include "WallBatch.h"
 #include <SDL2/SDL.h>
 #include <vector>
 
-	void castRays(GameMap *gMap, MapObject *player, SDL_Renderer *renderer, int angRange, int depth);
+	//how the 3D view gets onto the screen
+	enum RenderBackend{
+		RENDER_DRAW_CALLS,	//one draw call per wall column
+		RENDER_SOFTWARE,	//drawn into a frame buffer on the CPU, uploaded once
+		RENDER_GEOMETRY		//all wall columns batched into one SDL_RenderGeometry call
+	};
+	
+	//how far walls are textured by the software frame buffer
+	enum WallDetail{
+		DETAIL_FULL,	//always from the full texture
+		DETAIL_MIPMAP,	//from smaller copies of the texture as walls get shorter on screen
+		DETAIL_FLAT		//mipmapped, and walls only a few pixels tall get their texture's average color
+	};
+	
+	//rendering options that can be changed while the game is running
+	struct RenderOptions{
+		//how far away walls are still drawn, in blocks. 0 or less is unbounded,
+		//rays then only stop at the edge of the map
+		double drawDist;
+		//if drawDist is grown and shrunk every frame to hold targetFrameTime
+		bool autoDist;
+		//time the 3D view should take to render, in seconds
+		double targetFrameTime;
+		//how rays walk through the grid
+		TraversalMode traversal;
+		//if last frame's hits are reused while the player is only turning
+		bool reuseFrames;
+		//how the 3D view is drawn
+		RenderBackend backend;
+		//how far walls are textured, only the software backend looks at this
+		WallDetail detail;
+		//if the software backend fades walls, floors and ceilings into the fog with distance
+		bool fog;
+		//distance, in blocks, at which walls have faded fully into the fog
+		double fogDist;
+		//if the software backend draws textured floors and ceilings instead of the sky and the ground
+		bool floors;
+		//fraction of the screen width, around the center, where a ray is cast for every column
+		//further out only every 2nd column is cast, and every 4th near the edges, the columns
+		//in between are filled in from their neighbours. 1 or more casts every column
+		double foveaWidth;
+		//with more than 1, only every refineStep-th column is cast at first. Between two of them
+		//that hit the same wall, the columns are worked out from that wall, elsewhere the gap is
+		//halved and cast again until it's closed. Every column ends up as if it had been cast
+		int refineStep;
+		//size of the 3D view relative to the window, in (0, 1]. The view is cast and drawn
+		//at this size and stretched over the window
+		double renderScale;
+		//if renderScale is changed every few frames to hold targetFrameTime
+		bool autoScale;
+	};
+	
+	//render times gathered by adapt_render_scale since it last looked at them
+	struct ScaleGovernor{
+		double timeSum;
+		int frames;
+	};
+	
+	//regions of the screen with foveated casting: the center, the band around it, and the edges
+	const int FOVEA_REGIONS = 3;
+	
+	//the hits of the last frame, and everything they depend on
+	//while the player only turns, most of them can be reused for the next frame
+	struct FrameCache{
+		//false until a frame has been cast
+		bool valid;
+		//where the player was, and which way they were looking
+		double x, y;
+		bam_t ang;
+		//the map, draw distance, traversal and projection the hits were cast with
+		GameMap *gMap;
+		double maxDist;
+		TraversalMode traversal;
+		int wid;
+		double spread;
+		//hit of every column
+		std::vector<RayHit> hits, prevHits;
+		//columns recovered from the last frame and columns cast anew, in the last frame
+		int reused, cast;
+		//the columns in every foveated casting region, and how many of them were cast in the last frame
+		int regionColumns[FOVEA_REGIONS], regionCast[FOVEA_REGIONS];
+		//true if some of the hits were filled in instead of cast, they can't be reused then
+		bool approximate;
+		//the columns of the frame that get drawn, grouped by the kind of their material
+		std::vector<int> kindColumns[MATERIAL_KINDS];
+	};
+	
+	//draw distance in map units, HUGE_VAL if unbounded
+	double max_ray_dist( RenderOptions *opts );
+	//nudges the draw distance towards the target frame time, does nothing unless autoDist is set
+	void adapt_draw_distance( RenderOptions *opts, double renderTime );
+	//steps the render scale down or up after every few frames, by their average render time
+	//does nothing unless autoScale is set
+	void adapt_render_scale( RenderOptions *opts, ScaleGovernor *gov, double renderTime );
+	
+	//casts all columns into the hit buffer (in parallel if the pool has more than one thread)
+	//and then draws them on the main thread, the way opts->backend says: onto the renderer, into frame,
+	//or into batch, which is then flushed. colormap is only used for software rendering
+	void castRays(GameMap *gMap, MapObject *player, SDL_Renderer *renderer, FrameBuffer *frame, WallBatch *batch,
+				const ColorMap *colormap, Camera *cam, RenderOptions *opts, RayPool *pool, FrameCache *cache,
+				HitBuffer &hits);
 	bool input(GameMap *gMap, MapObject *player, std::vector<MapObject*> &agent_arr,
 				std::set<int> keys, double speed, double angVel, double dt);
 	bool checkWhiteBlock( GameMap *gMap, MapObject *player );
-	void create_dark_walls(SDL_Surface *wall_textures, SDL_Surface *dark_wall_textures, double wallColorRatio);
-	void frame_rate( SDL_Renderer *renderer, SDL_Texture *numbers, int fps );
+	void frame_rate( SDL_Renderer *renderer, Camera *cam, SDL_Texture *numbers, int fps );
+	
+	//casts axis parallel rays from grid aligned spots in every empty block, then ray_cnt random rays,
+	//on the given level images with both cast_ray and cast_ray_fixed
+	//prints how often they hit different cells, returns the number of mismatches
+	int compare_fixed_traversal( const char *const *levels, int level_cnt, int ray_cnt );
+	//times the trig tables against the standard library and prints how far off they are
+	void bench_trig( int samples );
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef TRIG_H
+#define TRIG_H
+
+#include <SDL2/SDL.h>
+
+	//binary angle measurement: the full circle is 2^32, so angles wrap around for free
+	//when added or subtracted, and casting the difference of two angles to Sint32 gives it in (-pi, pi)
+	typedef Uint32 bam_t;
+	
+	const bam_t BAM_QUARTER = 0x40000000u;
+	const bam_t BAM_HALF = 0x80000000u;
+	
+	//radians to binary angles and back
+	const double RAD_TO_BAM = 4294967296.0/6.283185307179586477;
+	const double BAM_TO_RAD = 6.283185307179586477/4294967296.0;
+	
+	//any angle in radians, not only ones in [0, 2pi)
+	inline bam_t rad_to_bam( double ang ){
+		return (bam_t)(Sint64)( ang*RAD_TO_BAM );
+	}
+	//in [0, 2pi)
+	inline double bam_to_rad( bam_t ang ){
+		return (double)ang*BAM_TO_RAD;
+	}
+	//in [-pi, pi)
+	inline double bam_to_signed_rad( bam_t ang ){
+		return (double)(Sint32)ang*BAM_TO_RAD;
+	}
+	
+	//the sine table has one entry every 2pi/SIN_TABLE_SIZE and a repeat of the first entry at the end,
+	//so that the entry after any index can be read for interpolation
+	const int SIN_TABLE_BITS = 12;
+	const int SIN_TABLE_SIZE = 1 << SIN_TABLE_BITS;
+	//bits of a binary angle below the table index
+	const int SIN_FRAC_BITS = 32 - SIN_TABLE_BITS;
+	
+	extern double sinTable[SIN_TABLE_SIZE + 1];
+	
+	//linearly interpolated between table entries, off by less than 3e-7
+	inline double bam_sin( bam_t ang ){
+		int i = ang >> SIN_FRAC_BITS;
+		double frac = (double)( ang & ( ( 1u << SIN_FRAC_BITS ) - 1 ) )*( 1.0/(double)( 1u << SIN_FRAC_BITS ) );
+		return sinTable[i] + ( sinTable[i + 1] - sinTable[i] )*frac;
+	}
+	inline double bam_cos( bam_t ang ){
+		return bam_sin( ang + BAM_QUARTER );
+	}
+	//tan has poles, so it isn't interpolated from a table of its own
+	inline double bam_tan( bam_t ang ){
+		return bam_sin( ang )/bam_cos( ang );
+	}
+	
+	//atan on [0, 1], the other octants are folded onto it
+	const int ATAN_TABLE_BITS = 10;
+	const int ATAN_TABLE_SIZE = 1 << ATAN_TABLE_BITS;
+	
+	//angle of the point (x, y), same argument order as std::atan2, off by less than 1e-7 radians
+	bam_t bam_atan2( double y, double x );
+
+#endif
@@ -0,0 +1,56 @@
+#include <cmath>
+
+//Refer to this header file for documentation
+#include <trig.h>
+
+double sinTable[SIN_TABLE_SIZE + 1];
+
+//atan in binary angles, with one extra entry for interpolation
+static double atanTable[ATAN_TABLE_SIZE + 1];
+
+//the tables are filled before main starts
+static struct TrigTables{
+	TrigTables(){
+		for( int i = 0; i <= SIN_TABLE_SIZE; i++ )
+			sinTable[i] = std::sin( (double)i*6.283185307179586477/SIN_TABLE_SIZE );
+		
+		//exact zeros and ones at the quarter turns, so that rays along the axes stay parallel to them
+		for( int i = 0; i <= SIN_TABLE_SIZE; i += SIN_TABLE_SIZE >> 2 ){
+			int quarter = ( i/( SIN_TABLE_SIZE >> 2 ) ) & 3;
+			sinTable[i] = quarter == 1 ? 1.0 : ( quarter == 3 ? -1.0 : 0.0 );
+		}
+		
+		for( int i = 0; i <= ATAN_TABLE_SIZE; i++ )
+			atanTable[i] = std::atan( (double)i/ATAN_TABLE_SIZE )*RAD_TO_BAM;
+	}
+} trig_tables;
+
+//atan of t in [0, 1], interpolated
+static inline double table_atan( double t ){
+	double pos = t*ATAN_TABLE_SIZE;
+	int i = (int)pos;
+	if( i >= ATAN_TABLE_SIZE )
+		return atanTable[ATAN_TABLE_SIZE];
+	return atanTable[i] + ( atanTable[i + 1] - atanTable[i] )*( pos - (double)i );
+}
+
+bam_t bam_atan2( double y, double x ){
+	
+	double absX = std::fabs(x), absY = std::fabs(y);
+	
+	if( absX == 0.0 && absY == 0.0 )
+		return 0;
+	
+	//angle in the first quadrant, from whichever octant the point is in
+	double ang = absY <= absX ? table_atan( absY/absX ) : (double)BAM_QUARTER - table_atan( absX/absY );
+	
+	bam_t bam = (bam_t)( ang + 0.5 );
+	
+	//mirroring into the other quadrants
+	if( x < 0 )
+		bam = BAM_HALF - bam;
+	if( y < 0 )
+		bam = -bam;
+	
+	return bam;
+}